@@ -19,6 +19,7 @@ echo ""
 qemu-system-aarch64 \
     -M virt \
     -cpu cortex-a57 \
+    -smp 4 \
     -kernel build/zixiao-arm64.elf \
     -m 512M \
     -nographic \
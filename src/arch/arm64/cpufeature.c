@@ -0,0 +1,38 @@
+/**
+ * ARM64 CPU Features - runtime selection of optional instructions
+ *
+ * The kernel is built for baseline ARMv8.0. Where a later extension is
+ * worth it, code tests a flag set here and takes the faster path; the
+ * flags only ever go from false to true, before secondaries are started.
+ */
+
+#include <arch/arm64_cpufeature.h>
+#include <kernel/console.h>
+
+bool arm64_lse_atomics __attribute__((aligned(64))) = false;
+bool arm64_mmu_enabled = false;
+
+static uint64_t read_isar0(void) {
+    uint64_t isar0;
+    __asm__ volatile("mrs %0, id_aa64isar0_el1" : "=r"(isar0));
+    return isar0;
+}
+
+static bool cpu_has_lse(void) {
+    uint64_t atomic = (read_isar0() >> ID_AA64ISAR0_ATOMIC_SHIFT) & ID_AA64ISAR0_ATOMIC_MASK;
+    return atomic >= ID_AA64ISAR0_ATOMIC_LSE;
+}
+
+void arm64_cpu_features_init(void) {
+    arm64_lse_atomics = cpu_has_lse();
+    __asm__ volatile("dsb ish" ::: "memory");
+
+    console_printf("      Atomics: %s\n", arm64_lse_atomics ? "LSE (ARMv8.1)" : "LL/SC");
+}
+
+void arm64_cpu_features_verify(uint32_t cpu) {
+    /* Mixed systems are not supported: LSE code is already running */
+    if (arm64_lse_atomics && !cpu_has_lse()) {
+        console_printf("ERROR: CPU%u lacks LSE atomics selected by the boot CPU\n", cpu);
+    }
+}
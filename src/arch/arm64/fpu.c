@@ -0,0 +1,34 @@
+/**
+ * ARM64 FP/SIMD Support
+ * CPACR_EL1.FPEN traps FP/SIMD instructions at EL1 outside
+ * kernel_fpu_begin()/kernel_fpu_end() sections. The register save and
+ * restore routines are in scheduler/fpu.S: this file is built with
+ * -mgeneral-regs-only.
+ */
+
+#include <kernel/fpu.h>
+
+#define CPACR_FPEN_MASK     (3UL << 20)
+#define CPACR_FPEN_TRAP     (0UL << 20)     /* Trap EL0 and EL1 accesses */
+#define CPACR_FPEN_NONE     (3UL << 20)     /* No trapping */
+
+static inline void cpacr_set_fpen(uint64_t fpen) {
+    uint64_t cpacr;
+    __asm__ volatile("mrs %0, cpacr_el1" : "=r"(cpacr));
+    cpacr = (cpacr & ~CPACR_FPEN_MASK) | fpen;
+    __asm__ volatile("msr cpacr_el1, %0\n"
+                     "isb"
+                     :: "r"(cpacr) : "memory");
+}
+
+void fpu_init_cpu(void) {
+    arch_fpu_disable();
+}
+
+void arch_fpu_enable(void) {
+    cpacr_set_fpen(CPACR_FPEN_NONE);
+}
+
+void arch_fpu_disable(void) {
+    cpacr_set_fpen(CPACR_FPEN_TRAP);
+}
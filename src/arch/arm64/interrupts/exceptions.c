@@ -1,5 +1,8 @@
 #include <kernel/console.h>
 #include <kernel/types.h>
+#include <kernel/sched.h>
+#include <kernel/tick.h>
+#include <kernel/preempt.h>
 #include <arch/arm64_gic.h>
 
 void arm64_exception_handler(void) {
@@ -11,8 +14,16 @@ void arm64_exception_handler(void) {
 }
 
 void arm64_irq_handler(void) {
-    /* Dispatch IRQ via GIC */
+    hardirq_enter();
+
+    /* A tickless idle CPU is busy again */
+    tick_nohz_irq_enter();
+
+    /* Dispatch IRQ via GIC (EOI is sent before we return here) */
     gic_handle_irq();
+
+    /* A pending need_resched is acted on by the vector stub on the way out */
+    hardirq_exit();
 }
 
 void interrupts_init(void) {
@@ -29,3 +40,22 @@ void interrupts_disable(void) {
     /* Mask IRQ interrupts at CPU level (set DAIF.I bit) */
     __asm__ volatile("msr daifset, #2" ::: "memory");
 }
+
+uint64_t interrupts_save(void) {
+    /* Read DAIF, then mask IRQs */
+    uint64_t flags;
+    __asm__ volatile("mrs %0, daif\n"
+                     "msr daifset, #2"
+                     : "=r"(flags) :: "memory");
+    return flags;
+}
+
+void interrupts_restore(uint64_t flags) {
+    __asm__ volatile("msr daif, %0" :: "r"(flags) : "memory");
+}
+
+bool interrupts_enabled(void) {
+    uint64_t daif;
+    __asm__ volatile("mrs %0, daif" : "=r"(daif));
+    return (daif & (1 << 7)) == 0;  /* DAIF.I clear */
+}
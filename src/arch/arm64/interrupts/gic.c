@@ -64,14 +64,40 @@ void gic_init(void) {
     /* 8. Enable distributor */
     mmio_write32(GICD_CTLR, 1);
 
-    /* 9. Configure CPU Interface */
+    /* 9. Configure boot CPU's interface */
+    gic_cpu_init();
+
+    console_printf("      GIC initialized\n");
+}
+
+/**
+ * Initialize the calling CPU's interface
+ * SGI/PPI enable and priority registers (IRQ 0-31) are banked per CPU.
+ */
+void gic_cpu_init(void) {
+    /* Disable banked PPIs, enable all SGIs (used for IPIs) */
+    mmio_write32(GICD_ICENABLER, 0xFFFF0000);
+    mmio_write32(GICD_ISENABLER, 0x0000FFFF);
+
+    /* SGIs/PPIs at lowest priority until a driver raises them */
+    for (uint32_t i = 0; i < GIC_PPI_MAX; i += 4) {
+        mmio_write32(GICD_IPRIORITYR + i, 0xA0A0A0A0);
+    }
+
     /* Set priority mask to lowest priority (allow all interrupts) */
     mmio_write32(GICC_PMR, 0xFF);
 
     /* Enable CPU interface */
     mmio_write32(GICC_CTLR, 1);
+}
 
-    console_printf("      GIC initialized\n");
+/**
+ * Send an SGI to the CPUs in cpu_mask
+ */
+void gic_send_sgi(uint32_t sgi, uint32_t cpu_mask) {
+    /* TargetListFilter = 0 (use list), CPUTargetList in bits [23:16] */
+    __asm__ volatile("dsb ishst" ::: "memory");  /* Publish data before the IPI */
+    mmio_write32(GICD_SGIR, ((cpu_mask & 0xFF) << 16) | (sgi & 0xF));
 }
 
 /**
@@ -141,8 +167,9 @@ void gic_uninstall_handler(uint32_t irq) {
  * Main IRQ dispatch routine
  */
 void gic_handle_irq(void) {
-    /* Acknowledge interrupt and get IRQ number */
-    uint32_t irq = gic_acknowledge_irq();
+    /* Acknowledge interrupt; keep the raw IAR since SGIs carry the source CPU */
+    uint32_t iar = mmio_read32(GICC_IAR);
+    uint32_t irq = iar & 0x3FF;
 
     /* Check for spurious interrupt */
     if (irq >= 1020) {
@@ -157,6 +184,6 @@ void gic_handle_irq(void) {
         console_printf("[GIC] Unhandled IRQ %u\n", irq);
     }
 
-    /* Signal end of interrupt */
-    gic_end_of_interrupt(irq);
+    /* Signal end of interrupt (EOIR must match the IAR value exactly) */
+    gic_end_of_interrupt(iar);
 }
@@ -1,23 +1,32 @@
 /**
  * ARM64 Generic Timer Driver
+ * CNTPCT_EL0 is the nanosecond clock; the banked EL1 physical timer is
+ * each CPU's one-shot event device for hrtimers (including the tick).
  */
 
 #include <arch/arm64_timer.h>
 #include <arch/arm64_gic.h>
 #include <kernel/console.h>
+#include <kernel/hrtimer.h>
 #include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/tick.h>
 
 /* Timer state */
 static uint64_t timer_frequency = 0;
 static uint64_t timer_ticks = 0;
-static uint64_t timer_interval = 0;  /* Counter ticks per timer tick */
+static uint64_t timer_heartbeat_sec = 0;
+
+/* Counter <-> nanosecond conversion factors (32.32 fixed point) */
+static uint64_t timer_ns_mult = 0;      /* ns = counter * mult >> 32 */
+static uint64_t timer_count_mult = 0;   /* counter = ns * mult >> 32 */
 
 /**
  * Read timer counter (CNTPCT_EL0)
  */
 uint64_t timer_get_counter(void) {
     uint64_t count;
-    __asm__ volatile("mrs %0, cntpct_el0" : "=r"(count));
+    __asm__ volatile("isb; mrs %0, cntpct_el0" : "=r"(count));
     return count;
 }
 
@@ -50,29 +59,47 @@ static void timer_write_control(uint32_t value) {
 }
 
 /**
- * Timer interrupt handler
+ * Monotonic nanoseconds since boot
  */
-void timer_irq_handler(void) {
-    /* Increment tick counter */
-    timer_ticks++;
-
-    /* Call scheduler tick to update time slices */
-    scheduler_tick();
+uint64_t timer_get_ns(void) {
+    return clock_scale(timer_get_counter(), timer_ns_mult);
+}
 
-    /* Print tick every second (for debugging) */
-    if (timer_ticks % TIMER_TICK_HZ == 0) {
-        console_printf("[Timer] Tick %llu (uptime: %llu seconds)\n",
-                       timer_ticks, timer_ticks / TIMER_TICK_HZ);
+/**
+ * Program this CPU's timer for one interrupt at expires_ns
+ */
+void timer_set_next_event(uint64_t expires_ns) {
+    if (expires_ns == HRTIMER_NO_EXPIRY) {
+        timer_write_control(0);
+        return;
     }
 
-    /* Trigger task switch every 10 ticks (100ms) */
-    if (timer_ticks % 10 == 0) {
-        schedule();
+    /* +1: never fire before expires_ns because of conversion rounding */
+    timer_write_cval(clock_scale(expires_ns, timer_count_mult) + 1);
+    timer_write_control(0x1);
+}
+
+/**
+ * Boot CPU: advance the global tick count
+ */
+void timer_account_ticks(uint64_t ticks) {
+    timer_ticks += ticks;
+
+    /* Print tick every second (for debugging; ticks may arrive in batches) */
+    if (timer_ticks / TIMER_TICK_HZ != timer_heartbeat_sec) {
+        timer_heartbeat_sec = timer_ticks / TIMER_TICK_HZ;
+        console_printf("[Timer] Tick %llu (uptime: %llu seconds)\n",
+                       timer_ticks, timer_heartbeat_sec);
     }
+}
 
-    /* Set next timer interrupt */
-    uint64_t current = timer_get_counter();
-    timer_write_cval(current + timer_interval);
+/**
+ * Timer interrupt handler (runs on every CPU; the timer is banked per CPU)
+ * Runs expired hrtimers, the scheduler tick among them. The switch
+ * itself happens on IRQ exit (arm64_irq_handler).
+ */
+void timer_irq_handler(void) {
+    hrtimer_interrupt();
 }
 
 /**
@@ -85,10 +112,11 @@ void timer_init(void) {
     timer_frequency = timer_read_frequency();
     console_printf("      Timer frequency: %llu Hz\n", timer_frequency);
 
-    /* Calculate interval for desired tick rate */
-    timer_interval = timer_frequency / TIMER_TICK_HZ;
-    console_printf("      Timer interval: %llu counts (%u Hz)\n",
-                   timer_interval, TIMER_TICK_HZ);
+    /* Both fit in 64 bits for any frequency below 4 GHz */
+    timer_ns_mult = (NSEC_PER_SEC << 32) / timer_frequency;
+    timer_count_mult = (timer_frequency << 32) / NSEC_PER_SEC;
+    console_printf("      Resolution: %llu ns per count, tick %u Hz\n",
+                   (timer_ns_mult + (1ULL << 31)) >> 32, TIMER_TICK_HZ);
 
     /* Reset tick counter */
     timer_ticks = 0;
@@ -96,21 +124,30 @@ void timer_init(void) {
     /* Disable timer while configuring */
     timer_write_control(0);
 
-    /* Set initial compare value */
-    uint64_t current = timer_get_counter();
-    timer_write_cval(current + timer_interval);
-
     /* Install timer IRQ handler in GIC */
     gic_install_handler(IRQ_TIMER_PHYS, timer_irq_handler);
     gic_set_priority(IRQ_TIMER_PHYS, 0x80);  /* Medium priority */
     gic_enable_irq(IRQ_TIMER_PHYS);
 
-    /* Enable timer: ENABLE=1, IMASK=0 (unmask interrupt) */
-    timer_write_control(0x1);
+    /* Programs the timer for the first tick */
+    tick_init_cpu();
 
     console_printf("      Timer initialized and enabled\n");
 }
 
+/**
+ * Start the calling secondary CPU's timer (frequency already known)
+ */
+void timer_init_secondary(void) {
+    timer_write_control(0);
+
+    /* Timer PPI priority and enable bits are banked per CPU */
+    gic_set_priority(IRQ_TIMER_PHYS, 0x80);
+    gic_enable_irq(IRQ_TIMER_PHYS);
+
+    tick_init_cpu();
+}
+
 /**
  * Get timer frequency
  */
@@ -129,15 +166,12 @@ uint64_t timer_get_ticks(void) {
  * Get uptime in milliseconds
  */
 uint64_t timer_get_uptime_ms(void) {
-    return (timer_ticks * 1000) / TIMER_TICK_HZ;
+    return timer_get_ns() / NSEC_PER_MSEC;
 }
 
 /**
  * Sleep for specified milliseconds (busy wait)
  */
 void timer_sleep_ms(uint32_t ms) {
-    uint64_t target_ticks = timer_get_counter() + ((uint64_t)ms * timer_frequency) / 1000;
-    while (timer_get_counter() < target_ticks) {
-        __asm__ volatile("nop");
-    }
+    ndelay((uint64_t)ms * NSEC_PER_MSEC);
 }
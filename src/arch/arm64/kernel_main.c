@@ -3,8 +3,11 @@
 #include <kernel/mm.h>
 #include <kernel/sched.h>
 #include <kernel/panic.h>
+#include <kernel/smp.h>
+#include <kernel/bench.h>
 #include <arch/interrupts.h>
 #include <arch/arm64_mmu.h>
+#include <arch/arm64_cpufeature.h>
 #include <arch/arm64_timer.h>
 
 extern char uart_getchar(void);
@@ -14,6 +17,12 @@ extern bool uart_has_data(void);
 extern char _kernel_end[];
 
 void kernel_main(void) {
+    /* Per-CPU area of the boot CPU (this_cpu() must work before anything else) */
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    smp_setup_cpu(0, mpidr & 0xff);
+    fpu_init_cpu();
+
     /* Initialize console (UART) */
     console_init();
 
@@ -41,6 +50,14 @@ void kernel_main(void) {
     console_printf("  [*] Initializing MMU and page tables...\n");
     arm64_mmu_init();
 
+    /* Spinlocks may use atomics from here on (no lock is held here: one
+     * taken while they were skipped must not be released after) */
+    arm64_mmu_enabled = true;
+
+    /* LSE atomics need cacheable memory: select them once the MMU is on */
+    console_printf("  [*] Detecting CPU features...\n");
+    arm64_cpu_features_init();
+
     /* Initialize interrupts */
     console_printf("  [*] Initializing exception handlers...\n");
     interrupts_init();
@@ -116,13 +133,18 @@ void kernel_main(void) {
     console_printf("Initializing Yuheng (玉衡) scheduler...\n");
 
     /* Disable interrupts during scheduler init to avoid timer interference */
-    __asm__ volatile("msr daifset, #2");  /* Disable IRQ */
-
+    interrupts_disable();
     scheduler_init();
+    smp_mark_online();
+    interrupts_enable();
 
-    /* Re-enable interrupts */
-    __asm__ volatile("msr daifclr, #2");  /* Enable IRQ */
+    /* Bring up secondary CPUs (each runs its own idle task and runqueue) */
+    smp_init();
 
+#ifdef KERNEL_BENCH
+    /* Benchmark build: the suite replaces the test tasks */
+    bench_start();
+#else
     /* Create test tasks */
     extern void test_task_a(void);
     extern void test_task_b(void);
@@ -137,6 +159,7 @@ void kernel_main(void) {
     task_ready(task_a);
     task_ready(task_b);
     task_ready(task_c);
+#endif
 
     console_printf("\nScheduler ready! Starting task execution...\n");
     console_printf("(Press 'p' to test kernel panic, Ctrl+A then X to exit QEMU)\n\n");
@@ -174,7 +197,7 @@ void kernel_main(void) {
             }
         }
 
-        /* Wait for interrupt - scheduler will be triggered by timer */
-        __asm__ volatile("wfi");
+        /* Sleep until an interrupt (tickless while nothing is runnable) */
+        cpu_idle();
     }
 }
@@ -168,6 +168,42 @@ uint64_t arm64_get_current_page_table(void)
     return ttbr0;
 }
 
+/**
+ * Helper: MAIR_EL1 value (Memory Attribute Indirection Register)
+ */
+static uint64_t mmu_mair_value(void)
+{
+    uint64_t mair = 0;
+    mair |= (0x00ULL << (MT_DEVICE_nGnRnE * 8)); /* Device memory */
+    mair |= (0x44ULL << (MT_NORMAL_NC * 8));      /* Normal non-cacheable */
+    mair |= (0xFFULL << (MT_NORMAL * 8));          /* Normal cacheable */
+    return mair;
+}
+
+/**
+ * Helper: TCR_EL1 value (Translation Control Register)
+ */
+static uint64_t mmu_tcr_value(void)
+{
+    uint64_t tcr = 0;
+    tcr |= (16ULL << 0);   /* T0SZ = 16 (48-bit VA for TTBR0) */
+    tcr |= (0ULL << 6);    /* Reserved */
+    tcr |= (0ULL << 7);    /* EPD0 = 0 (enable TTBR0 walks) */
+    tcr |= (3ULL << 8);    /* IRGN0 = 3 (inner write-back cacheable) */
+    tcr |= (3ULL << 10);   /* ORGN0 = 3 (outer write-back cacheable) */
+    tcr |= (3ULL << 12);   /* SH0 = 3 (inner shareable) */
+    tcr |= (0ULL << 14);   /* TG0 = 0 (4KB granule for TTBR0) - FIXED! */
+    tcr |= (16ULL << 16);  /* T1SZ = 16 (48-bit VA for TTBR1) */
+    tcr |= (0ULL << 22);   /* A1 = 0 (TTBR0 defines ASID) */
+    tcr |= (1ULL << 23);   /* EPD1 = 1 (disable TTBR1 walks for now) */
+    tcr |= (3ULL << 24);   /* IRGN1 = 3 */
+    tcr |= (3ULL << 26);   /* ORGN1 = 3 */
+    tcr |= (3ULL << 28);   /* SH1 = 3 */
+    tcr |= (0ULL << 30);   /* TG1 = 0 (4KB granule for TTBR1) - FIXED! */
+    tcr |= (1ULL << 32);   /* IPS = 1 (36-bit PA space, 64GB) - FIXED! Was 25! */
+    return tcr;
+}
+
 /**
  * Initialize ARM64 MMU
  */
@@ -225,31 +261,13 @@ void arm64_mmu_init(void)
 
     /* Configure MAIR_EL1 (Memory Attribute Indirection Register) */
     console_printf("      Configuring MAIR_EL1...\n");
-    uint64_t mair = 0;
-    mair |= (0x00ULL << (MT_DEVICE_nGnRnE * 8)); /* Device memory */
-    mair |= (0x44ULL << (MT_NORMAL_NC * 8));      /* Normal non-cacheable */
-    mair |= (0xFFULL << (MT_NORMAL * 8));          /* Normal cacheable */
+    uint64_t mair = mmu_mair_value();
     __asm__ volatile("msr mair_el1, %0" :: "r"(mair));
     console_printf("      MAIR_EL1 configured\n");
 
     /* Configure TCR_EL1 (Translation Control Register) */
     console_printf("      Configuring TCR_EL1...\n");
-    uint64_t tcr = 0;
-    tcr |= (16ULL << 0);   /* T0SZ = 16 (48-bit VA for TTBR0) */
-    tcr |= (0ULL << 6);    /* Reserved */
-    tcr |= (0ULL << 7);    /* EPD0 = 0 (enable TTBR0 walks) */
-    tcr |= (3ULL << 8);    /* IRGN0 = 3 (inner write-back cacheable) */
-    tcr |= (3ULL << 10);   /* ORGN0 = 3 (outer write-back cacheable) */
-    tcr |= (3ULL << 12);   /* SH0 = 3 (inner shareable) */
-    tcr |= (0ULL << 14);   /* TG0 = 0 (4KB granule for TTBR0) - FIXED! */
-    tcr |= (16ULL << 16);  /* T1SZ = 16 (48-bit VA for TTBR1) */
-    tcr |= (0ULL << 22);   /* A1 = 0 (TTBR0 defines ASID) */
-    tcr |= (1ULL << 23);   /* EPD1 = 1 (disable TTBR1 walks for now) */
-    tcr |= (3ULL << 24);   /* IRGN1 = 3 */
-    tcr |= (3ULL << 26);   /* ORGN1 = 3 */
-    tcr |= (3ULL << 28);   /* SH1 = 3 */
-    tcr |= (0ULL << 30);   /* TG1 = 0 (4KB granule for TTBR1) - FIXED! */
-    tcr |= (1ULL << 32);   /* IPS = 1 (36-bit PA space, 64GB) - FIXED! Was 25! */
+    uint64_t tcr = mmu_tcr_value();
     __asm__ volatile("msr tcr_el1, %0" :: "r"(tcr));
     console_printf("      TCR_EL1 configured\n");
 
@@ -278,3 +296,27 @@ void arm64_mmu_init(void)
 
     console_printf("      MMU enabled with 4-level page tables\n");
 }
+
+/**
+ * Enable the MMU on a secondary CPU using the kernel page table
+ * built by arm64_mmu_init() (no console output: called during bring-up)
+ */
+void arm64_mmu_init_secondary(void)
+{
+    __asm__ volatile("msr mair_el1, %0" :: "r"(mmu_mair_value()));
+    __asm__ volatile("msr tcr_el1, %0" :: "r"(mmu_tcr_value()));
+    __asm__ volatile("msr ttbr0_el1, %0" :: "r"((uint64_t)kernel_pgd));
+    __asm__ volatile("isb");
+
+    /* Drop any stale translations from before this CPU was powered on */
+    __asm__ volatile("tlbi vmalle1");
+    __asm__ volatile("dsb sy");
+    __asm__ volatile("isb");
+
+    /* Same SCTLR_EL1 setup as the boot CPU: MMU on, caches off */
+    uint64_t sctlr;
+    __asm__ volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    sctlr |= (1 << 0);  /* M bit - Enable MMU */
+    __asm__ volatile("msr sctlr_el1, %0" :: "r"(sctlr));
+    __asm__ volatile("isb");
+}
@@ -0,0 +1,144 @@
+/**
+ * ARM64 SMP Bring-up
+ * Starts secondary CPUs with PSCI CPU_ON; each gets its own boot stack,
+ * GIC CPU interface, Generic Timer and scheduler runqueue.
+ */
+
+#include <kernel/smp.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <arch/interrupts.h>
+#include <arch/arm64_gic.h>
+#include <arch/arm64_mmu.h>
+#include <arch/arm64_cpufeature.h>
+#include <arch/arm64_psci.h>
+#include <arch/arm64_timer.h>
+
+/* Boot/idle stack for each secondary CPU (CPU 0 uses _stack_top) */
+#define SECONDARY_STACK_SIZE 16384
+static uint8_t secondary_stacks[MAX_CPUS][SECONDARY_STACK_SIZE] __attribute__((aligned(16)));
+
+/* How long to wait for a CPU to report online */
+#define SECONDARY_BOOT_TIMEOUT_MS 1000
+
+/* Assembly entry point for secondaries (boot.S) */
+extern void secondary_entry(void);
+
+/**
+ * Issue a PSCI CPU_ON call through the HVC conduit
+ */
+int64_t psci_cpu_on(uint64_t target_mpidr, uint64_t entry, uint64_t context_id) {
+    register uint64_t x0 __asm__("x0") = PSCI_0_2_FN64_CPU_ON;
+    register uint64_t x1 __asm__("x1") = target_mpidr;
+    register uint64_t x2 __asm__("x2") = entry;
+    register uint64_t x3 __asm__("x3") = context_id;
+
+    __asm__ volatile("hvc #0"
+                     : "+r"(x0)
+                     : "r"(x1), "r"(x2), "r"(x3)
+                     : "memory");
+    return (int64_t)x0;
+}
+
+/* Fill in a CPU's per-CPU area (any CPU, before that CPU uses it) */
+static void smp_init_cpu_local(uint32_t cpu, uint64_t hw_id) {
+    cpu_local_t* local = &cpu_locals[cpu];
+
+    local->self = local;
+    local->cpu_id = cpu;
+    local->hw_id = hw_id;
+    local->online = false;
+    local->irq_stack_top = smp_irq_stack_top(cpu);
+}
+
+/**
+ * Set up this CPU's per-CPU area and point TPIDR_EL1 at it
+ */
+void smp_setup_cpu(uint32_t cpu, uint64_t hw_id) {
+    smp_init_cpu_local(cpu, hw_id);
+    __asm__ volatile("msr tpidr_el1, %0" :: "r"(&cpu_locals[cpu]) : "memory");
+}
+
+/**
+ * C entry point for secondary CPUs (from secondary_entry, MMU off, IRQs masked)
+ */
+void secondary_main(void) {
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    uint32_t cpu = mpidr & MPIDR_AFF0_MASK;
+
+    /* Same address space as the boot CPU. Nothing shared may be touched
+     * before this: with the MMU off accesses bypass the caches, and would
+     * miss (or be overwritten by) lines other CPUs hold dirty. */
+    arm64_mmu_init_secondary();
+
+    /* The boot CPU filled in our per-CPU area before CPU_ON */
+    __asm__ volatile("msr tpidr_el1, %0" :: "r"(&cpu_locals[cpu]) : "memory");
+    fpu_init_cpu();
+    arm64_cpu_features_verify(cpu);
+
+    /* Banked interrupt state, then this CPU's idle task and runqueue */
+    gic_cpu_init();
+    scheduler_init_cpu();
+    timer_init_secondary();
+
+    smp_mark_online();
+    interrupts_enable();
+
+    /* This context is now the CPU's idle task */
+    idle_task_entry();
+}
+
+/**
+ * Reschedule IPI handler
+ * The sender already set our need_resched flag; arm64_irq_handler acts on
+ * it once the SGI is EOI'd.
+ */
+static void ipi_reschedule_handler(void) {
+}
+
+/**
+ * Boot all secondary CPUs
+ * Probes MPIDR Aff0 = 1..MAX_CPUS-1; PSCI rejects CPUs that do not exist.
+ */
+void smp_init(void) {
+    console_printf("  [*] Starting secondary CPUs (PSCI CPU_ON)...\n");
+
+    gic_install_handler(IPI_RESCHEDULE, ipi_reschedule_handler);
+
+    for (uint32_t cpu = 1; cpu < MAX_CPUS; cpu++) {
+        uint64_t stack_top = (uint64_t)&secondary_stacks[cpu][SECONDARY_STACK_SIZE];
+        smp_init_cpu_local(cpu, cpu);   /* Aff0 = logical number */
+        int64_t ret = psci_cpu_on(cpu, (uint64_t)secondary_entry, stack_top);
+
+        if (ret == PSCI_RET_INVALID_PARAMS || ret == PSCI_RET_NOT_PRESENT) {
+            break;  /* No more CPUs */
+        }
+        if (ret != PSCI_RET_SUCCESS) {
+            console_printf("      CPU %u: CPU_ON failed (%lld)\n", cpu, ret);
+            continue;
+        }
+
+        /* Wait for the CPU to come up before starting the next one */
+        uint64_t deadline = timer_get_counter() +
+                            (timer_get_frequency() * SECONDARY_BOOT_TIMEOUT_MS) / 1000;
+        while (!cpu_locals[cpu].online && timer_get_counter() < deadline) {
+            __asm__ volatile("yield");
+        }
+
+        if (cpu_locals[cpu].online) {
+            console_printf("      CPU %u online\n", cpu);
+        } else {
+            console_printf("      CPU %u did not come online\n", cpu);
+        }
+    }
+
+    console_printf("      %u CPU(s) online\n", smp_num_cpus());
+}
+
+/**
+ * Send a reschedule IPI
+ */
+void smp_send_reschedule(uint32_t cpu) {
+    gic_send_sgi(IPI_RESCHEDULE, 1U << cpu);
+}
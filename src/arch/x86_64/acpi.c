@@ -0,0 +1,156 @@
+/**
+ * x86_64 ACPI Table Discovery
+ * Finds the RSDP in the BIOS areas, walks the RSDT/XSDT to the MADT and
+ * lists the enabled processors' local APIC IDs.
+ */
+
+#include <arch/x86_64_acpi.h>
+#include <arch/x86_64_lapic.h>
+#include <arch/x86_64_mmu.h>
+#include <kernel/console.h>
+#include <kernel/string.h>
+
+/* BIOS areas searched for the RSDP */
+#define BDA_EBDA_SEGMENT    0x40E       /* Word: EBDA segment */
+#define BIOS_ROM_START      0xE0000
+#define BIOS_ROM_END        0x100000
+
+/* Identity map a firmware range before reading it */
+static bool acpi_map(uint64_t phys, uint64_t size) {
+    return x86_64_map_identity(phys, size, PTE_WRITE) == 0;
+}
+
+static bool acpi_checksum_ok(const void* data, uint32_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+/* Search a range for "RSD PTR " on a 16-byte boundary */
+static acpi_rsdp_t* acpi_scan_rsdp(uint64_t start, uint64_t end) {
+    if (!acpi_map(start, end - start)) {
+        return NULL;
+    }
+
+    for (uint64_t addr = start; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+        acpi_rsdp_t* rsdp = (acpi_rsdp_t*)addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum_ok(rsdp, 20)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+static acpi_rsdp_t* acpi_find_rsdp(void) {
+    /* First KiB of the Extended BIOS Data Area */
+    acpi_map(0, PAGE_SIZE);
+    /* The BDA sits at a small constant address the compiler would treat
+     * as a null-pointer access: hide the value from it */
+    volatile uint16_t* bda_ebda = (volatile uint16_t*)BDA_EBDA_SEGMENT;
+    __asm__("" : "+r"(bda_ebda));
+    uint64_t ebda = (uint64_t)*bda_ebda << 4;
+    x86_64_unmap_page((page_table_t)x86_64_get_current_page_table(), 0);
+
+    acpi_rsdp_t* rsdp = NULL;
+    if (ebda >= 0x80000 && ebda < 0xA0000) {
+        rsdp = acpi_scan_rsdp(ebda, ebda + 1024);
+    }
+    if (rsdp == NULL) {
+        rsdp = acpi_scan_rsdp(BIOS_ROM_START, BIOS_ROM_END);
+    }
+    return rsdp;
+}
+
+/* Map a table (header first, then its full length) and verify it */
+static acpi_sdt_header_t* acpi_map_table(uint64_t phys) {
+    if (phys == 0 || !acpi_map(phys, sizeof(acpi_sdt_header_t))) {
+        return NULL;
+    }
+
+    acpi_sdt_header_t* table = (acpi_sdt_header_t*)phys;
+    if (!acpi_map(phys, table->length) || !acpi_checksum_ok(table, table->length)) {
+        return NULL;
+    }
+    return table;
+}
+
+/* Find a table by signature through the XSDT (ACPI 2.0+) or RSDT */
+static acpi_sdt_header_t* acpi_find_table(acpi_rsdp_t* rsdp, const char* signature) {
+    bool use_xsdt = rsdp->revision >= 2 && rsdp->xsdt_address != 0;
+    acpi_sdt_header_t* root = acpi_map_table(use_xsdt ? rsdp->xsdt_address
+                                                      : rsdp->rsdt_address);
+    if (root == NULL) {
+        return NULL;
+    }
+
+    uint32_t entry_size = use_xsdt ? 8 : 4;
+    uint32_t count = (root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uint8_t* entries = (uint8_t*)root + sizeof(acpi_sdt_header_t);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t phys;
+        if (use_xsdt) {
+            memcpy(&phys, entries + i * 8, 8);  /* Entries are unaligned */
+        } else {
+            uint32_t phys32;
+            memcpy(&phys32, entries + i * 4, 4);
+            phys = phys32;
+        }
+
+        acpi_sdt_header_t* table = acpi_map_table(phys);
+        if (table && memcmp(table->signature, signature, 4) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Enumerate processors from the ACPI MADT
+ */
+bool acpi_get_cpu_info(acpi_cpu_info_t* info) {
+    info->lapic_base = LAPIC_DEFAULT_BASE;
+    info->cpu_count = 0;
+
+    acpi_rsdp_t* rsdp = acpi_find_rsdp();
+    if (rsdp == NULL) {
+        console_printf("      ACPI: RSDP not found\n");
+        return false;
+    }
+
+    acpi_madt_t* madt = (acpi_madt_t*)acpi_find_table(rsdp, "APIC");
+    if (madt == NULL) {
+        console_printf("      ACPI: MADT not found\n");
+        return false;
+    }
+
+    info->lapic_base = madt->lapic_address;
+
+    uint8_t* ptr = (uint8_t*)madt + sizeof(acpi_madt_t);
+    uint8_t* end = (uint8_t*)madt + madt->header.length;
+
+    while (ptr + sizeof(acpi_madt_entry_t) <= end) {
+        acpi_madt_entry_t* entry = (acpi_madt_entry_t*)ptr;
+        if (entry->length < sizeof(acpi_madt_entry_t)) {
+            break;  /* Malformed table */
+        }
+
+        if (entry->type == ACPI_MADT_LOCAL_APIC) {
+            acpi_madt_local_apic_t* lapic = (acpi_madt_local_apic_t*)entry;
+            if ((lapic->flags & ACPI_MADT_LAPIC_ENABLED) && info->cpu_count < MAX_CPUS) {
+                info->apic_ids[info->cpu_count++] = lapic->apic_id;
+            }
+        } else if (entry->type == ACPI_MADT_LAPIC_ADDR_OVERRIDE) {
+            acpi_madt_lapic_override_t* override = (acpi_madt_lapic_override_t*)entry;
+            info->lapic_base = override->lapic_address;
+        }
+
+        ptr += entry->length;
+    }
+
+    return true;
+}
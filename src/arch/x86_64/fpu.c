@@ -0,0 +1,59 @@
+/**
+ * x86_64 FP/SIMD (x87/SSE) Support
+ * SSE is enabled with CR4.OSFXSR; CR0.TS makes any x87/SSE instruction
+ * raise #NM outside kernel_fpu_begin()/kernel_fpu_end() sections.
+ */
+
+#include <kernel/fpu.h>
+
+#define CR0_MP          (1UL << 1)      /* WAIT honours TS */
+#define CR0_EM          (1UL << 2)      /* x87 emulation (must be clear) */
+#define CR0_TS          (1UL << 3)      /* Task switched: trap FP/SIMD */
+#define CR4_OSFXSR      (1UL << 9)      /* FXSAVE/FXRSTOR and SSE */
+#define CR4_OSXMMEXCPT  (1UL << 10)     /* SIMD exceptions via #XM */
+
+#define MXCSR_DEFAULT   0x1F80          /* All exceptions masked, round to nearest */
+
+static inline uint64_t read_cr0(void) {
+    uint64_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint64_t cr0) {
+    __asm__ volatile("mov %0, %%cr0" :: "r"(cr0) : "memory");
+}
+
+void fpu_init_cpu(void) {
+    uint64_t cr4;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP);
+    arch_fpu_reset();
+    arch_fpu_disable();
+}
+
+void arch_fpu_enable(void) {
+    __asm__ volatile("clts" ::: "memory");
+}
+
+void arch_fpu_disable(void) {
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+void arch_fpu_save(fpu_state_t* state) {
+    __asm__ volatile("fxsave64 %0" : "=m"(*state) :: "memory");
+}
+
+void arch_fpu_restore(const fpu_state_t* state) {
+    __asm__ volatile("fxrstor64 %0" :: "m"(*state) : "memory");
+}
+
+void arch_fpu_reset(void) {
+    uint32_t mxcsr = MXCSR_DEFAULT;
+    __asm__ volatile("fninit\n"
+                     "ldmxcsr %0"
+                     :: "m"(mxcsr) : "memory");
+}
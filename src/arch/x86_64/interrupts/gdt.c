@@ -45,3 +45,8 @@ void gdt_init(void) {
 
     gdt_flush((uint64_t)&gp);
 }
+
+/* Load the (already built) GDT on an application processor */
+void gdt_load(void) {
+    gdt_flush((uint64_t)&gp);
+}
@@ -2,6 +2,10 @@
 #include <kernel/console.h>
 #include <kernel/string.h>
 #include <arch/interrupts.h>
+#include <arch/x86_64_lapic.h>
+#include <kernel/sched.h>
+#include <kernel/tick.h>
+#include <kernel/preempt.h>
 
 /* IDT Entry */
 struct idt_entry {
@@ -23,8 +27,10 @@ struct idt_ptr {
 static struct idt_entry idt[256];
 static struct idt_ptr idtp;
 
-/* IRQ handlers table */
-static irq_handler_t irq_handlers[16] = {0};
+/* IRQ handlers table: 0-15 legacy PIC, 16-223 local APIC vectors 48-255 */
+#define IRQ_COUNT 224
+#define IRQ_PIC_COUNT 16
+static irq_handler_t irq_handlers[IRQ_COUNT] = {0};
 
 /* External ASM functions */
 extern void idt_load(uint64_t);
@@ -98,6 +104,11 @@ void interrupts_init(void) {
     idt_load((uint64_t)&idtp);
 }
 
+/* Load the shared IDT on an application processor */
+void idt_load_cpu(void) {
+    idt_load((uint64_t)&idtp);
+}
+
 void interrupts_enable(void) {
     __asm__ volatile("sti");
 }
@@ -106,14 +117,38 @@ void interrupts_disable(void) {
     __asm__ volatile("cli");
 }
 
+uint64_t interrupts_save(void) {
+    /* Read RFLAGS, then clear IF */
+    uint64_t flags;
+    __asm__ volatile("pushfq\n"
+                     "popq %0\n"
+                     "cli"
+                     : "=r"(flags) :: "memory");
+    return flags;
+}
+
+void interrupts_restore(uint64_t flags) {
+    __asm__ volatile("pushq %0\n"
+                     "popfq"
+                     :: "r"(flags) : "memory", "cc");
+}
+
+bool interrupts_enabled(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq\n"
+                     "popq %0"
+                     : "=r"(flags) :: "memory");
+    return (flags & 0x200) != 0;    /* RFLAGS.IF */
+}
+
 void irq_install_handler(uint8_t irq, irq_handler_t handler) {
-    if (irq < 16) {
+    if (irq < IRQ_COUNT) {
         irq_handlers[irq] = handler;
     }
 }
 
 void irq_uninstall_handler(uint8_t irq) {
-    if (irq < 16) {
+    if (irq < IRQ_COUNT) {
         irq_handlers[irq] = 0;
     }
 }
@@ -121,15 +156,29 @@ void irq_uninstall_handler(uint8_t irq) {
 /* IRQ handler called from ASM */
 void irq_handler(uint64_t irq_num) {
     /* Send EOI */
-    if (irq_num >= 8) {
-        outb(PIC2_COMMAND, 0x20);
+    if (irq_num < IRQ_PIC_COUNT) {
+        if (irq_num >= 8) {
+            outb(PIC2_COMMAND, 0x20);
+        }
+        outb(PIC1_COMMAND, 0x20);
+    } else if (irq_num == IRQ_LAPIC_SPURIOUS) {
+        return;     /* Spurious: no EOI */
+    } else {
+        lapic_eoi();
     }
-    outb(PIC1_COMMAND, 0x20);
+
+    hardirq_enter();
+
+    /* A tickless idle CPU is busy again (HLT returns only after this IRQ) */
+    tick_nohz_irq_enter();
 
     /* Call handler */
     if (irq_handlers[irq_num]) {
         irq_handlers[irq_num]();
     }
+
+    /* A pending need_resched is acted on by irq_common_stub on the way out */
+    hardirq_exit();
 }
 
 /* Exception handler */
@@ -0,0 +1,189 @@
+/**
+ * x86_64 Local APIC Driver
+ * xAPIC (MMIO) mode. The PIT ticks the boot CPU until the local APIC
+ * timer (and the TSC) are calibrated against it; from then on every CPU
+ * uses its own local APIC timer, one-shot or in TSC-deadline mode, as the
+ * event device for its hrtimers.
+ */
+
+#include <arch/x86_64_lapic.h>
+#include <arch/x86_64_cpu.h>
+#include <arch/x86_64_mmu.h>
+#include <arch/x86_64_timer.h>
+#include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/sched.h>
+
+/* MMIO base (identity mapped) */
+static volatile uint32_t* lapic_base = NULL;
+
+/* Local APIC timer counts (divide by 16) per scheduler tick */
+static uint32_t lapic_timer_ticks = 0;
+
+/* Number of PIT ticks to measure the APIC timer over */
+#define LAPIC_CALIBRATE_TICKS 10
+
+/* Longest one-shot we program; later expiries are re-armed on the way */
+#define LAPIC_ONESHOT_MAX_NS  NSEC_PER_SEC
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / 4] = value;
+}
+
+/* Busy-wait for at least ms milliseconds using the PIT tick count */
+static void lapic_delay_ms(uint32_t ms) {
+    uint64_t ticks = ((uint64_t)ms * TIMER_TICK_HZ + 999) / 1000 + 1;
+    uint64_t target = timer_get_ticks() + ticks;
+
+    while (timer_get_ticks() < target) {
+        __asm__ volatile("pause");
+    }
+}
+
+/* Wait for the previous IPI to be accepted */
+static void lapic_wait_icr(void) {
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        __asm__ volatile("pause");
+    }
+}
+
+/**
+ * Map the local APIC and enable it on the boot CPU
+ */
+void lapic_init(uint64_t phys_base) {
+    if (x86_64_map_identity(phys_base, PAGE_SIZE, PTE_WRITE | PTE_DEVICE) != 0) {
+        console_printf("ERROR: Failed to map local APIC\n");
+        return;
+    }
+    lapic_base = (volatile uint32_t*)phys_base;
+
+    lapic_cpu_init();
+    console_printf("      Local APIC at 0x%llx (ID %u)\n", phys_base, lapic_id());
+}
+
+/**
+ * Enable the local APIC of the calling CPU
+ */
+void lapic_cpu_init(void) {
+    /* Software enable; unclaimed interrupts arrive on the spurious vector */
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+}
+
+/**
+ * Get the calling CPU's local APIC ID
+ */
+uint32_t lapic_id(void) {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/**
+ * Signal end of interrupt
+ */
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/**
+ * Send a fixed-vector IPI
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    lapic_wait_icr();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, vector);     /* Writing the low half sends it */
+}
+
+/**
+ * Send INIT: the processor resets and waits for a Start-up IPI
+ */
+void lapic_send_init(uint32_t apic_id) {
+    lapic_wait_icr();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+    lapic_wait_icr();
+}
+
+/**
+ * Send INIT-SIPI-SIPI
+ */
+void lapic_start_ap(uint32_t apic_id, uint8_t page) {
+    lapic_send_init(apic_id);
+    lapic_delay_ms(10);
+
+    /* Second SIPI covers a first one lost by older processors */
+    for (int i = 0; i < 2; i++) {
+        lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+        lapic_write(LAPIC_ICR_LOW, LAPIC_ICR_STARTUP | page);
+        lapic_wait_icr();
+        lapic_delay_ms(1);
+    }
+}
+
+/**
+ * Measure the local APIC timer and the TSC against the PIT
+ */
+uint64_t lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+
+    /* Start counting on a PIT tick edge */
+    uint64_t start = timer_get_ticks();
+    while (timer_get_ticks() == start) {
+        __asm__ volatile("pause");
+    }
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    uint64_t tsc_start = rdtsc();
+
+    start = timer_get_ticks();
+    while (timer_get_ticks() < start + LAPIC_CALIBRATE_TICKS) {
+        __asm__ volatile("pause");
+    }
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+    uint64_t tsc_per_tick = (rdtsc() - tsc_start) / LAPIC_CALIBRATE_TICKS;
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    lapic_timer_ticks = elapsed / LAPIC_CALIBRATE_TICKS;
+    console_printf("      APIC timer: %u counts per tick, TSC: %llu cycles per tick\n",
+                   lapic_timer_ticks, tsc_per_tick);
+    return tsc_per_tick;
+}
+
+/**
+ * Set up the calling CPU's local APIC timer as an (unarmed) event device
+ */
+void lapic_timer_start(bool tsc_deadline) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR |
+                (tsc_deadline ? LAPIC_TIMER_TSC_DEADLINE : LAPIC_TIMER_ONESHOT));
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    /* The mode switch must land before the first TSC_DEADLINE write (SDM 10.5.4.1) */
+    __asm__ volatile("mfence" ::: "memory");
+}
+
+/**
+ * Arm the one-shot timer delta_ns from now
+ */
+void lapic_timer_oneshot(uint64_t delta_ns) {
+    if (delta_ns > LAPIC_ONESHOT_MAX_NS) {
+        delta_ns = LAPIC_ONESHOT_MAX_NS;
+    }
+
+    uint64_t counts = delta_ns * lapic_timer_ticks / SCHED_TICK_NS;
+    if (counts == 0) {
+        counts = 1;     /* 0 would stop the timer */
+    }
+    lapic_write(LAPIC_TIMER_INIT, (uint32_t)counts);
+}
+
+/**
+ * Disarm the one-shot timer
+ */
+void lapic_timer_stop(void) {
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
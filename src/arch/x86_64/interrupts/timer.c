@@ -1,14 +1,31 @@
 /**
  * x86_64 PIT (Programmable Interval Timer - 8254) Driver
+ * The PIT only ticks the boot CPU during early boot. Once the TSC and the
+ * local APIC timer are calibrated against it, the TSC is the nanosecond
+ * clock and each CPU's local APIC timer its one-shot hrtimer device.
  */
 
 #include <arch/x86_64_timer.h>
+#include <arch/x86_64_cpu.h>
+#include <arch/x86_64_lapic.h>
 #include <arch/interrupts.h>
 #include <kernel/console.h>
+#include <kernel/hrtimer.h>
 #include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/tick.h>
 
 /* Timer state */
 static uint64_t timer_ticks = 0;
+static uint64_t timer_heartbeat_sec = 0;
+
+/* TSC clock: ns = ns_base + (tsc - tsc_base) * tsc_ns_mult >> 32 */
+static bool tsc_ready = false;
+static bool tsc_deadline = false;       /* Local APIC timers use TSC-deadline mode */
+static uint64_t tsc_base = 0;
+static uint64_t tsc_ns_base = 0;
+static uint64_t tsc_ns_mult = 0;        /* ns per cycle (32.32) */
+static uint64_t tsc_cycle_mult = 0;     /* cycles per ns (32.32) */
 
 /* Helper: Write byte to I/O port */
 static inline void outb(uint16_t port, uint8_t val) {
@@ -23,27 +40,117 @@ static inline uint8_t inb(uint16_t port) {
 }
 
 /**
- * Timer interrupt handler
+ * Boot CPU: advance the global tick count
+ */
+void timer_account_ticks(uint64_t ticks) {
+    timer_ticks += ticks;
+
+    /* Print tick every second (for debugging; ticks may arrive in batches) */
+    if (timer_ticks / TIMER_TICK_HZ != timer_heartbeat_sec) {
+        timer_heartbeat_sec = timer_ticks / TIMER_TICK_HZ;
+        console_printf("[Timer] Tick %llu (uptime: %llu seconds)\n",
+                       timer_ticks, timer_heartbeat_sec);
+    }
+}
+
+/**
+ * PIT interrupt handler (boot CPU, until its local APIC timer takes over)
  */
 void timer_irq_handler(void) {
-    /* Increment tick counter */
-    timer_ticks++;
+    timer_account_ticks(1);
 
     /* Call scheduler tick to update time slices */
     scheduler_tick();
 
-    /* Print tick every second (for debugging) */
-    if (timer_ticks % TIMER_TICK_HZ == 0) {
-        console_printf("[Timer] Tick %llu (uptime: %llu seconds)\n",
-                       timer_ticks, timer_ticks / TIMER_TICK_HZ);
+    /* Note: PIC EOI (End of Interrupt) is sent automatically by irq_handler() in idt.c,
+     * which also switches tasks on the way out if the scheduler asked for it */
+}
+
+/**
+ * Local APIC timer interrupt handler: expired hrtimers (the tick among them)
+ */
+void timer_local_irq_handler(void) {
+    hrtimer_interrupt();
+}
+
+/**
+ * Monotonic nanoseconds since boot (PIT ticks until the TSC is calibrated)
+ */
+uint64_t timer_get_ns(void) {
+    if (!tsc_ready) {
+        return timer_ticks * SCHED_TICK_NS;
+    }
+    return tsc_ns_base + clock_scale(rdtsc() - tsc_base, tsc_ns_mult);
+}
+
+/**
+ * Program this CPU's local APIC timer for one interrupt at expires_ns
+ */
+void timer_set_next_event(uint64_t expires_ns) {
+    if (!tsc_ready) {
+        return;     /* Still ticking from the PIT */
     }
 
-    /* Trigger task switch every 10 ticks (100ms) */
-    if (timer_ticks % 10 == 0) {
-        schedule();
+    if (tsc_deadline) {
+        uint64_t deadline = 0;  /* 0 disarms */
+        if (expires_ns != HRTIMER_NO_EXPIRY) {
+            uint64_t delta = expires_ns > tsc_ns_base ? expires_ns - tsc_ns_base : 0;
+            /* +1: never fire before expires_ns because of conversion rounding */
+            deadline = tsc_base + clock_scale(delta, tsc_cycle_mult) + 1;
+        }
+        wrmsr(MSR_TSC_DEADLINE, deadline);
+        return;
     }
 
-    /* Note: PIC EOI (End of Interrupt) is sent automatically by irq_handler() in idt.c */
+    if (expires_ns == HRTIMER_NO_EXPIRY) {
+        lapic_timer_stop();
+        return;
+    }
+    uint64_t now = timer_get_ns();
+    lapic_timer_oneshot(expires_ns > now ? expires_ns - now : 0);
+}
+
+/**
+ * Calibrate the TSC and local APIC timer, then move the boot CPU's tick
+ * from the PIT to its local APIC timer
+ */
+void timer_switch_to_lapic(void) {
+    uint64_t tsc_per_tick = lapic_timer_calibrate();
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    tsc_deadline = (ecx & CPUID_1_ECX_TSC_DEADLINE) != 0;
+
+    uint64_t flags = interrupts_save();
+
+    irq_uninstall_handler(0);
+
+    /* Mode 0 with the shortest count: one last interrupt, then silence */
+    outb(PIT_COMMAND, PIT_CMD_CHANNEL0 | PIT_CMD_LOHI | PIT_CMD_MODE0 | PIT_CMD_BINARY);
+    outb(PIT_CHANNEL0, 1);
+    outb(PIT_CHANNEL0, 0);
+
+    /* Continue the PIT's timeline from here on the TSC */
+    tsc_ns_base = timer_ticks * SCHED_TICK_NS;
+    tsc_base = rdtsc();
+    tsc_ns_mult = (SCHED_TICK_NS << 32) / tsc_per_tick;
+    tsc_cycle_mult = (tsc_per_tick << 32) / SCHED_TICK_NS;
+    tsc_ready = true;
+
+    lapic_timer_start(tsc_deadline);
+    tick_init_cpu();
+
+    interrupts_restore(flags);
+    console_printf("      Boot CPU tick moved to the local APIC timer (%s mode)\n",
+                   tsc_deadline ? "TSC-deadline" : "one-shot");
+}
+
+/**
+ * Start the calling AP's local APIC timer and tick (after the boot CPU's switch)
+ */
+void timer_init_secondary(void) {
+    lapic_timer_start(tsc_deadline);
+    tick_init_cpu();
 }
 
 /**
@@ -100,20 +207,12 @@ uint64_t timer_get_ticks(void) {
  * Get uptime in milliseconds
  */
 uint64_t timer_get_uptime_ms(void) {
-    return (timer_ticks * 1000) / TIMER_TICK_HZ;
+    return timer_get_ns() / NSEC_PER_MSEC;
 }
 
 /**
- * Sleep for specified milliseconds (busy wait)
- *
- * Note: This is a simple busy-wait implementation.
- * For more efficient sleep, wait for scheduler implementation.
+ * Sleep for specified milliseconds (busy wait on the TSC clock)
  */
 void timer_sleep_ms(uint32_t ms) {
-    uint64_t target_ticks = timer_ticks + ((uint64_t)ms * TIMER_TICK_HZ) / 1000;
-
-    /* Busy wait until target ticks reached */
-    while (timer_ticks < target_ticks) {
-        __asm__ volatile("pause");  /* x86 PAUSE instruction for spin-wait loop */
-    }
+    ndelay((uint64_t)ms * NSEC_PER_MSEC);
 }
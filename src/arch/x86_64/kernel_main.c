@@ -3,6 +3,8 @@
 #include <kernel/mm.h>
 #include <kernel/string.h>
 #include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/bench.h>
 #include <arch/interrupts.h>
 #include <arch/x86_64_mmu.h>
 #include <arch/x86_64_timer.h>
@@ -49,6 +51,10 @@ void kernel_main(uint32_t magic, uint32_t mbi_addr) {
     console_printf("  [*] Initializing GDT...\n");
     gdt_init();
 
+    /* Per-CPU area of the boot CPU (after the GDT: loading GS clears its base) */
+    smp_setup_cpu(0, 0);
+    fpu_init_cpu();
+
     /* Initialize interrupts */
     console_printf("  [*] Initializing IDT...\n");
     interrupts_init();
@@ -119,27 +125,43 @@ void kernel_main(uint32_t magic, uint32_t mbi_addr) {
 
     /* Initialize Yuheng scheduler */
     console_printf("Initializing Yuheng (玉衡) scheduler...\n");
+
+    /* Disable interrupts during scheduler init to avoid timer interference */
+    interrupts_disable();
     scheduler_init();
+    smp_mark_online();
+    interrupts_enable();
 
+    /* Bring up application processors (each runs its own idle task and runqueue) */
+    smp_init();
+
+#ifdef KERNEL_BENCH
+    /* Benchmark build: the suite replaces the test tasks */
+    bench_start();
+#else
     /* Create test tasks */
     extern void test_task_a(void);
     extern void test_task_b(void);
     extern void test_task_c(void);
 
     console_printf("Creating test tasks...\n");
-    task_create("test_a", test_task_a, 5, 8192);
-    task_create("test_b", test_task_b, 5, 8192);
-    task_create("test_c", test_task_c, 3, 8192);
+    task_struct_t* task_a = task_create("test_a", test_task_a, 5, 8192);
+    task_struct_t* task_b = task_create("test_b", test_task_b, 5, 8192);
+    task_struct_t* task_c = task_create("test_c", test_task_c, 3, 8192);
+
+    /* Add tasks to ready queue */
+    task_ready(task_a);
+    task_ready(task_b);
+    task_ready(task_c);
+#endif
 
     console_printf("\nScheduler ready! Starting task execution...\n");
     console_printf("(Press Ctrl+C in terminal to exit QEMU)\n\n");
 
-    /* Start scheduling - this will never return */
-    schedule();
+    /* Become the idle task - timer interrupts switch to ready tasks */
+    console_printf("Entering idle loop (kernel_main becomes idle task)...\n\n");
 
-    /* Should never reach here */
-    console_printf("ERROR: Scheduler returned!\n");
     while (1) {
-        __asm__ volatile("hlt");
+        cpu_idle();
     }
 }
@@ -158,6 +158,22 @@ uint64_t x86_64_get_current_page_table(void)
     return cr3 & PTE_ADDR_MASK;  /* Mask off control bits */
 }
 
+/**
+ * Identity map a physical range in the kernel page table
+ */
+int x86_64_map_identity(uint64_t phys_addr, uint64_t size, uint64_t flags)
+{
+    uint64_t start = phys_addr & ~(PAGE_SIZE - 1);
+    uint64_t end = (phys_addr + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    for (uint64_t addr = start; addr < end; addr += PAGE_SIZE) {
+        if (x86_64_map_page(kernel_pml4, addr, addr, flags) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /**
  * Initialize x86_64 MMU
  */
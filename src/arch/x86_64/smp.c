@@ -0,0 +1,168 @@
+/**
+ * x86_64 SMP Bring-up
+ * Starts every processor listed in the ACPI MADT with INIT-SIPI-SIPI. APs
+ * enter through a real-mode trampoline, switch to long mode on the kernel
+ * page table, then set up their GDT/IDT, local APIC, per-CPU area (GS base),
+ * idle task and local APIC timer.
+ */
+
+#include <kernel/smp.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/string.h>
+#include <arch/interrupts.h>
+#include <arch/x86_64_acpi.h>
+#include <arch/x86_64_cpu.h>
+#include <arch/x86_64_lapic.h>
+#include <arch/x86_64_mmu.h>
+#include <arch/x86_64_timer.h>
+
+/* Trampoline location: below 1 MiB, page aligned (SIPI vector = page number) */
+#define TRAMPOLINE_BASE 0x8000
+
+/* Boot/idle stack for each AP (the BSP uses boot.S's stack) */
+#define AP_STACK_SIZE 16384
+static uint8_t ap_stacks[MAX_CPUS][AP_STACK_SIZE] __attribute__((aligned(16)));
+
+/* How long to wait for an AP to report online */
+#define AP_BOOT_TIMEOUT_MS 1000
+
+/* Trampoline image (boot/trampoline.S) */
+extern char trampoline_start[];
+extern char trampoline_data[];
+extern char trampoline_end[];
+
+/* Parameters read by the trampoline (must match trampoline.S) */
+typedef struct ap_boot_data {
+    uint64_t cr3;           /* Kernel PML4 */
+    uint64_t stack_top;     /* AP boot stack */
+    uint64_t entry;         /* ap_main */
+    uint64_t cpu;           /* Logical CPU number */
+} ap_boot_data_t;
+
+/* Defined in gdt.c / idt.c */
+extern void gdt_load(void);
+extern void idt_load_cpu(void);
+
+/**
+ * Set up this CPU's per-CPU area and point GS base at it
+ * Must run after the GDT is loaded: reloading GS clears its base.
+ */
+void smp_setup_cpu(uint32_t cpu, uint64_t hw_id) {
+    cpu_local_t* local = &cpu_locals[cpu];
+
+    local->self = local;
+    local->cpu_id = cpu;
+    local->hw_id = hw_id;   /* Local APIC ID */
+    local->online = false;
+    local->irq_stack_top = smp_irq_stack_top(cpu);
+
+    wrmsr(MSR_GS_BASE, (uint64_t)local);
+}
+
+/**
+ * C entry point for APs (from the trampoline, paging on, IRQs off)
+ */
+static void ap_main(uint32_t cpu) {
+    gdt_load();
+    idt_load_cpu();
+    lapic_cpu_init();
+
+    smp_setup_cpu(cpu, lapic_id());
+    fpu_init_cpu();
+
+    /* This CPU's idle task and runqueue, then its scheduler tick */
+    scheduler_init_cpu();
+    timer_init_secondary();
+
+    smp_mark_online();
+    interrupts_enable();
+
+    /* This context is now the CPU's idle task */
+    idle_task_entry();
+}
+
+/**
+ * Reschedule IPI handler
+ * The sender already set our need_resched flag; irq_handler acts on it
+ * after the EOI.
+ */
+static void ipi_reschedule_handler(void) {
+}
+
+/* Start one AP and wait for it to come online */
+static bool smp_boot_ap(uint32_t cpu, uint8_t apic_id) {
+    ap_boot_data_t* data = (ap_boot_data_t*)
+        (TRAMPOLINE_BASE + (trampoline_data - trampoline_start));
+
+    data->cr3 = x86_64_get_current_page_table();
+    data->stack_top = (uint64_t)&ap_stacks[cpu][AP_STACK_SIZE];
+    data->entry = (uint64_t)ap_main;
+    data->cpu = cpu;
+    __asm__ volatile("mfence" ::: "memory");
+
+    lapic_start_ap(apic_id, TRAMPOLINE_BASE >> 12);
+
+    uint64_t deadline = timer_get_ticks() + (AP_BOOT_TIMEOUT_MS * TIMER_TICK_HZ) / 1000;
+    while (!cpu_locals[cpu].online && timer_get_ticks() < deadline) {
+        __asm__ volatile("pause");
+    }
+    return cpu_locals[cpu].online;
+}
+
+/**
+ * Boot all application processors
+ */
+void smp_init(void) {
+    console_printf("  [*] Starting application processors (INIT-SIPI)...\n");
+
+    acpi_cpu_info_t info;
+    acpi_get_cpu_info(&info);
+
+    lapic_init(info.lapic_base);
+    cpu_locals[0].hw_id = lapic_id();
+
+    irq_install_handler(IRQ_RESCHEDULE, ipi_reschedule_handler);
+    irq_install_handler(IRQ_LAPIC_TIMER, timer_local_irq_handler);
+
+    /* Calibrate against the PIT, then drop it for one-shot APIC timers */
+    timer_switch_to_lapic();
+
+    if (info.cpu_count <= 1) {
+        console_printf("      1 CPU online\n");
+        return;
+    }
+
+    /* Install the trampoline (identity mapped: APs run it as paging turns on) */
+    x86_64_map_identity(TRAMPOLINE_BASE, PAGE_SIZE, PTE_WRITE);
+    memcpy((void*)TRAMPOLINE_BASE, trampoline_start,
+           trampoline_end - trampoline_start);
+
+    uint32_t cpu = 1;
+    for (uint32_t i = 0; i < info.cpu_count && cpu < MAX_CPUS; i++) {
+        uint8_t apic_id = info.apic_ids[i];
+        if (apic_id == cpu_locals[0].hw_id) {
+            continue;   /* BSP */
+        }
+
+        if (smp_boot_ap(cpu, apic_id)) {
+            console_printf("      CPU %u online (APIC ID %u)\n", cpu, apic_id);
+        } else {
+            /* A slow AP may still be on its way through the trampoline:
+             * park it with INIT, and never hand its logical number and
+             * stack to the next one in case it got far enough to use them */
+            lapic_send_init(apic_id);
+            console_printf("      CPU with APIC ID %u did not come online\n", apic_id);
+        }
+        cpu++;
+    }
+
+    console_printf("      %u CPU(s) online\n", smp_num_cpus());
+}
+
+/**
+ * Send a reschedule IPI
+ */
+void smp_send_reschedule(uint32_t cpu) {
+    lapic_send_ipi(cpu_locals[cpu].hw_id, IPI_RESCHEDULE_VECTOR);
+}
@@ -0,0 +1,35 @@
+/**
+ * ARM64 CPU Features
+ * Optional instructions the kernel picks at boot from the ID registers.
+ */
+
+#ifndef ARM64_CPUFEATURE_H
+#define ARM64_CPUFEATURE_H
+
+#include <kernel/types.h>
+
+/* ID_AA64ISAR0_EL1.Atomic: 0b0010 = LSE (CAS, LDADD, SWP, ...) */
+#define ID_AA64ISAR0_ATOMIC_SHIFT   20
+#define ID_AA64ISAR0_ATOMIC_MASK    0xFULL
+#define ID_AA64ISAR0_ATOMIC_LSE     2
+
+/* True once the boot CPU found ARMv8.1 LSE atomics (read-mostly) */
+extern bool arm64_lse_atomics;
+
+/* True once the boot CPU's MMU is on. Before that every access is
+ * Device-nGnRnE, where exclusives and LSE atomics may never succeed, so
+ * spinlocks are skipped (only the boot CPU runs). */
+extern bool arm64_mmu_enabled;
+
+/**
+ * Read the boot CPU's ID registers and select optional instructions
+ * (once, before secondaries start; until then the baseline is used)
+ */
+void arm64_cpu_features_init(void);
+
+/**
+ * Check that a secondary CPU supports what the boot CPU selected
+ */
+void arm64_cpu_features_verify(uint32_t cpu);
+
+#endif /* ARM64_CPUFEATURE_H */
@@ -22,6 +22,7 @@
 #define GICD_IPRIORITYR (GICD_BASE + 0x400)   /* Interrupt Priority Registers */
 #define GICD_ITARGETSR  (GICD_BASE + 0x800)   /* Interrupt Processor Targets Registers */
 #define GICD_ICFGR      (GICD_BASE + 0xC00)   /* Interrupt Configuration Registers */
+#define GICD_SGIR       (GICD_BASE + 0xF00)   /* Software Generated Interrupt Register */
 
 /* GIC CPU Interface registers (GICC) */
 #define GICC_CTLR       (GICC_BASE + 0x000)   /* CPU Interface Control Register */
@@ -35,6 +36,9 @@
 #define GIC_PPI_MAX     32      /* Private Peripheral Interrupts (16-31) */
 #define GIC_SPI_BASE    32      /* Shared Peripheral Interrupts start at 32 */
 
+/* SGIs used for inter-processor interrupts */
+#define IPI_RESCHEDULE  0       /* Ask target CPU to call schedule() */
+
 /* ARM Generic Timer IRQ numbers (PPIs on QEMU virt) */
 #define IRQ_TIMER_PHYS  30      /* Physical Timer (PPI 14, IRQ 30) */
 #define IRQ_TIMER_VIRT  27      /* Virtual Timer (PPI 11, IRQ 27) */
@@ -43,10 +47,23 @@
 typedef void (*irq_handler_t)(void);
 
 /**
- * Initialize GIC (Distributor and CPU Interface)
+ * Initialize GIC (Distributor and boot CPU's CPU Interface)
  */
 void gic_init(void);
 
+/**
+ * Initialize the calling CPU's GIC CPU Interface and banked SGI/PPI state
+ * (called by every CPU; gic_init() does it for the boot CPU)
+ */
+void gic_cpu_init(void);
+
+/**
+ * Send a Software-Generated Interrupt to a set of CPUs
+ * @param sgi - SGI number (0-15)
+ * @param cpu_mask - Bitmask of target CPU interfaces
+ */
+void gic_send_sgi(uint32_t sgi, uint32_t cpu_mask);
+
 /**
  * Enable a specific IRQ
  * @param irq - IRQ number (0-1023)
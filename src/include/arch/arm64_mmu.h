@@ -56,6 +56,11 @@ typedef uint64_t* page_table_t;
  */
 void arm64_mmu_init(void);
 
+/**
+ * Enable the MMU on a secondary CPU with the kernel page table
+ */
+void arm64_mmu_init_secondary(void);
+
 /**
  * Create a new empty page table (for processes)
  * @return Pointer to new page table, or NULL on failure
@@ -0,0 +1,37 @@
+/**
+ * ARM Power State Coordination Interface (PSCI 0.2+)
+ * Used to power secondary CPUs on. QEMU virt (no EL2/EL3) uses the HVC conduit.
+ */
+
+#ifndef ARM64_PSCI_H
+#define ARM64_PSCI_H
+
+#include <kernel/types.h>
+
+/* PSCI function IDs (SMC64 calling convention) */
+#define PSCI_0_2_FN_PSCI_VERSION    0x84000000
+#define PSCI_0_2_FN64_CPU_ON        0xC4000003
+
+/* PSCI return codes */
+#define PSCI_RET_SUCCESS            0
+#define PSCI_RET_NOT_SUPPORTED      -1
+#define PSCI_RET_INVALID_PARAMS     -2
+#define PSCI_RET_DENIED             -3
+#define PSCI_RET_ALREADY_ON         -4
+#define PSCI_RET_ON_PENDING         -5
+#define PSCI_RET_INTERNAL_FAILURE   -6
+#define PSCI_RET_NOT_PRESENT        -7
+
+/* MPIDR_EL1 affinity level 0 (CPU within cluster) */
+#define MPIDR_AFF0_MASK             0xFF
+
+/**
+ * Power on a CPU
+ * @param target_mpidr - MPIDR affinity of the CPU to start
+ * @param entry - Physical address where the CPU starts (at EL1, MMU off)
+ * @param context_id - Value passed to the CPU in x0
+ * @return PSCI_RET_* status
+ */
+int64_t psci_cpu_on(uint64_t target_mpidr, uint64_t entry, uint64_t context_id);
+
+#endif /* ARM64_PSCI_H */
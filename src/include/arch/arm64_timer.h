@@ -22,6 +22,13 @@
  */
 void timer_init(void);
 
+/**
+ * Start the Generic Timer on a secondary CPU
+ * - Uses the frequency measured by timer_init()
+ * - Enables the (banked) timer PPI on the calling CPU
+ */
+void timer_init_secondary(void);
+
 /**
  * Get current timer counter value
  * @return 64-bit counter value
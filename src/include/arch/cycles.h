@@ -0,0 +1,25 @@
+#ifndef ZIXIAO_CYCLES_H
+#define ZIXIAO_CYCLES_H
+
+#include <kernel/types.h>
+
+// Read the free-running cycle counter, ordered against surrounding
+// instructions: CNTPCT_EL0 on ARM64 (fixed frequency, not CPU cycles),
+// the TSC on x86_64
+static inline uint64_t arch_cycles(void) {
+#if defined(__aarch64__)
+    uint64_t cnt;
+    __asm__ volatile("isb\n"
+                     "mrs %0, cntpct_el0"
+                     : "=r"(cnt) :: "memory");
+    return cnt;
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("lfence\n"
+                     "rdtsc"
+                     : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+#endif // ZIXIAO_CYCLES_H
@@ -10,6 +10,13 @@ void interrupts_init(void);
 void interrupts_enable(void);
 void interrupts_disable(void);
 
+// Disable interrupts, returning the previous state for interrupts_restore()
+uint64_t interrupts_save(void);
+void interrupts_restore(uint64_t flags);
+
+// True if interrupts are enabled on this CPU
+bool interrupts_enabled(void);
+
 // IRQ handlers
 typedef void (*irq_handler_t)(void);
 void irq_install_handler(uint8_t irq, irq_handler_t handler);
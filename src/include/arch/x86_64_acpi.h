@@ -0,0 +1,84 @@
+/**
+ * x86_64 ACPI Table Discovery
+ * Just enough ACPI to enumerate processors from the MADT
+ */
+
+#ifndef X86_64_ACPI_H
+#define X86_64_ACPI_H
+
+#include <kernel/types.h>
+#include <kernel/smp.h>
+
+/* Root System Description Pointer */
+typedef struct acpi_rsdp {
+    char signature[8];          /* "RSD PTR " */
+    uint8_t checksum;           /* Covers the first 20 bytes */
+    char oem_id[6];
+    uint8_t revision;           /* 0 = ACPI 1.0, 2 = ACPI 2.0+ (XSDT valid) */
+    uint32_t rsdt_address;
+    uint32_t length;            /* ACPI 2.0+ fields */
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp_t;
+
+/* Common header of all system description tables */
+typedef struct acpi_sdt_header {
+    char signature[4];
+    uint32_t length;            /* Including this header */
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+/* Multiple APIC Description Table ("APIC") */
+typedef struct acpi_madt {
+    acpi_sdt_header_t header;
+    uint32_t lapic_address;     /* 32-bit local APIC base */
+    uint32_t flags;
+    /* Variable-length interrupt controller structures follow */
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct acpi_madt_entry {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) acpi_madt_entry_t;
+
+#define ACPI_MADT_LOCAL_APIC            0
+#define ACPI_MADT_LAPIC_ADDR_OVERRIDE   5
+
+typedef struct acpi_madt_local_apic {
+    acpi_madt_entry_t header;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_local_apic_t;
+
+typedef struct acpi_madt_lapic_override {
+    acpi_madt_entry_t header;
+    uint16_t reserved;
+    uint64_t lapic_address;
+} __attribute__((packed)) acpi_madt_lapic_override_t;
+
+#define ACPI_MADT_LAPIC_ENABLED         (1 << 0)
+#define ACPI_MADT_LAPIC_ONLINE_CAPABLE  (1 << 1)
+
+/* Processors found in the MADT */
+typedef struct acpi_cpu_info {
+    uint64_t lapic_base;        /* Physical local APIC base */
+    uint32_t cpu_count;         /* Usable processors (at most MAX_CPUS) */
+    uint8_t apic_ids[MAX_CPUS]; /* Local APIC ID of each usable processor */
+} acpi_cpu_info_t;
+
+/**
+ * Enumerate processors from the ACPI MADT
+ * @param info - Filled with the local APIC base and processor APIC IDs
+ * @return true if a MADT was found
+ */
+bool acpi_get_cpu_info(acpi_cpu_info_t* info);
+
+#endif /* X86_64_ACPI_H */
@@ -0,0 +1,43 @@
+/**
+ * x86_64 CPU Helpers
+ * Model-specific registers, CPUID and the time-stamp counter
+ */
+
+#ifndef X86_64_CPU_H
+#define X86_64_CPU_H
+
+#include <kernel/types.h>
+
+/* Model-specific registers */
+#define MSR_TSC_DEADLINE    0x6E0       /* IA32_TSC_DEADLINE */
+#define MSR_GS_BASE         0xC0000101  /* IA32_GS_BASE */
+
+/* CPUID leaf 1, ECX */
+#define CPUID_1_ECX_TSC_DEADLINE    (1U << 24)
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile("wrmsr"
+                     :: "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
+                         uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(0));
+}
+
+/* Read the time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif /* X86_64_CPU_H */
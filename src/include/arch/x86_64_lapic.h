@@ -0,0 +1,112 @@
+/**
+ * x86_64 Local APIC Driver
+ * Per-CPU interrupt controller: inter-processor interrupts and the local timer
+ */
+
+#ifndef X86_64_LAPIC_H
+#define X86_64_LAPIC_H
+
+#include <kernel/types.h>
+
+/* Default physical base (may be overridden by the ACPI MADT) */
+#define LAPIC_DEFAULT_BASE  0xFEE00000
+
+/* Local APIC registers (offsets from base) */
+#define LAPIC_ID            0x020   /* Local APIC ID (bits 31:24) */
+#define LAPIC_EOI           0x0B0   /* End of Interrupt */
+#define LAPIC_SVR           0x0F0   /* Spurious Interrupt Vector Register */
+#define LAPIC_ICR_LOW       0x300   /* Interrupt Command Register [31:0] */
+#define LAPIC_ICR_HIGH      0x310   /* Interrupt Command Register [63:32] */
+#define LAPIC_LVT_TIMER     0x320   /* LVT Timer Register */
+#define LAPIC_TIMER_INIT    0x380   /* Timer Initial Count */
+#define LAPIC_TIMER_CUR     0x390   /* Timer Current Count */
+#define LAPIC_TIMER_DIV     0x3E0   /* Timer Divide Configuration */
+
+/* Register bits */
+#define LAPIC_SVR_ENABLE        (1 << 8)
+#define LAPIC_ICR_INIT          (5 << 8)    /* Delivery mode: INIT */
+#define LAPIC_ICR_STARTUP       (6 << 8)    /* Delivery mode: Start-up (SIPI) */
+#define LAPIC_ICR_PENDING       (1 << 12)   /* Delivery status: send pending */
+#define LAPIC_ICR_ASSERT        (1 << 14)   /* Level: assert */
+#define LAPIC_LVT_MASKED        (1 << 16)
+#define LAPIC_TIMER_ONESHOT     (0 << 17)
+#define LAPIC_TIMER_PERIODIC    (1 << 17)
+#define LAPIC_TIMER_TSC_DEADLINE (2 << 17)
+#define LAPIC_TIMER_DIV_16      0x3
+
+/* Interrupt vectors owned by the local APIC */
+#define LAPIC_TIMER_VECTOR      0x30
+#define IPI_RESCHEDULE_VECTOR   0x31
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+/* IRQ numbers as seen by irq_install_handler() (vector - 32) */
+#define IRQ_LAPIC_TIMER         (LAPIC_TIMER_VECTOR - 32)
+#define IRQ_RESCHEDULE          (IPI_RESCHEDULE_VECTOR - 32)
+#define IRQ_LAPIC_SPURIOUS      (LAPIC_SPURIOUS_VECTOR - 32)
+
+/**
+ * Map the local APIC and enable it on the boot CPU
+ * @param phys_base - Physical MMIO base of the local APIC
+ */
+void lapic_init(uint64_t phys_base);
+
+/**
+ * Enable the local APIC of the calling CPU
+ */
+void lapic_cpu_init(void);
+
+/**
+ * Get the calling CPU's local APIC ID
+ */
+uint32_t lapic_id(void);
+
+/**
+ * Signal end of interrupt for the in-service local APIC vector
+ */
+void lapic_eoi(void);
+
+/**
+ * Send a fixed-vector IPI
+ * @param apic_id - Destination local APIC ID
+ * @param vector - Interrupt vector
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+
+/**
+ * Send INIT, parking the processor until a Start-up IPI
+ * @param apic_id - Destination local APIC ID
+ */
+void lapic_send_init(uint32_t apic_id);
+
+/**
+ * Send INIT followed by two Start-up IPIs (MP specification sequence)
+ * @param apic_id - Destination local APIC ID
+ * @param page - Real-mode start page (start address >> 12)
+ */
+void lapic_start_ap(uint32_t apic_id, uint8_t page);
+
+/**
+ * Measure the local APIC timer and the TSC against the PIT
+ * (boot CPU, IRQs enabled, PIT ticking)
+ * @return TSC cycles per scheduler tick
+ */
+uint64_t lapic_timer_calibrate(void);
+
+/**
+ * Set up the calling CPU's local APIC timer as a one-shot event device
+ * @param tsc_deadline - Use TSC-deadline mode (armed through MSR_TSC_DEADLINE)
+ */
+void lapic_timer_start(bool tsc_deadline);
+
+/**
+ * Arm the one-shot timer (not in TSC-deadline mode)
+ * @param delta_ns - Time from now (capped at one second)
+ */
+void lapic_timer_oneshot(uint64_t delta_ns);
+
+/**
+ * Disarm the one-shot timer
+ */
+void lapic_timer_stop(void);
+
+#endif /* X86_64_LAPIC_H */
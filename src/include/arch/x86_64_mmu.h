@@ -85,4 +85,14 @@ void x86_64_switch_page_table(page_table_t pml4);
  */
 uint64_t x86_64_get_current_page_table(void);
 
+/**
+ * Identity map a physical range in the kernel page table
+ * Used for firmware tables, device MMIO and the AP trampoline.
+ * @param phys_addr - Start of range (rounded down to a page)
+ * @param size - Size of range in bytes (rounded up to whole pages)
+ * @param flags - PTE flags (WRITE, DEVICE, ...)
+ * @return 0 on success, -1 on failure
+ */
+int x86_64_map_identity(uint64_t phys_addr, uint64_t size, uint64_t flags);
+
 #endif /* X86_64_MMU_H */
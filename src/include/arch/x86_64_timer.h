@@ -77,4 +77,21 @@ void timer_sleep_ms(uint32_t ms);
  */
 void timer_irq_handler(void);
 
+/**
+ * Local APIC timer interrupt handler (hrtimers, including the scheduler
+ * tick, of every CPU once its local APIC timer runs)
+ */
+void timer_local_irq_handler(void);
+
+/**
+ * Calibrate the TSC and local APIC timer against the PIT, stop the PIT
+ * and run the boot CPU's tick from its local APIC timer
+ */
+void timer_switch_to_lapic(void);
+
+/**
+ * Start the calling AP's local APIC timer and scheduler tick
+ */
+void timer_init_secondary(void);
+
 #endif /* X86_64_TIMER_H */
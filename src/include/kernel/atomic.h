@@ -0,0 +1,232 @@
+/**
+ * Atomic Operations
+ *
+ * atomic_t / atomic64_t counters and the raw arch_atomic*() operations
+ * they are built on (for lock words and other plain fields):
+ *
+ *     atomic_t refs = ATOMIC_INIT(1);
+ *     atomic_inc(&refs);
+ *     if (atomic_dec_and_test(&refs)) { ... last reference ... }
+ *
+ * Ordering: read-modify-write operations are fully ordered unless named
+ * _acquire; atomic_read()/atomic_set() are relaxed; the _acquire loads
+ * and _release stores pair with each other.
+ *
+ * On x86_64 every read-modify-write is one LOCK-prefixed instruction
+ * (XADD, XCHG, CMPXCHG). On ARM64 the kernel is built for ARMv8.0, so
+ * each operation has an LL/SC loop (LDXR/STXR) and a single ARMv8.1 LSE
+ * instruction (LDADD, SWP, CAS), picked at run time from
+ * arm64_lse_atomics. Under contention LSE operations are performed at
+ * the cache instead of retrying a loop on every CPU.
+ */
+
+#ifndef KERNEL_ATOMIC_H
+#define KERNEL_ATOMIC_H
+
+#include <kernel/types.h>
+
+#if defined(__aarch64__)
+#include <arch/arm64_cpufeature.h>
+#endif
+
+/* Full memory barrier */
+static inline void smp_mb(void) {
+#if defined(__aarch64__)
+    __asm__ volatile("dmb ish" ::: "memory");
+#else
+    __asm__ volatile("mfence" ::: "memory");
+#endif
+}
+
+/* Busy-wait hint: lets an SMT sibling run (and saves power) while spinning */
+static inline void cpu_relax(void) {
+#if defined(__aarch64__)
+    __asm__ volatile("yield" ::: "memory");
+#else
+    __asm__ volatile("pause" ::: "memory");
+#endif
+}
+
+/* Acquire load / release store of a plain variable (LDAR/STLR, MOV on x86) */
+#define smp_load_acquire(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/******************************************************************************
+ * Raw Operations
+ *****************************************************************************/
+
+#if defined(__aarch64__)
+
+/* The LSE forms are assembled into a baseline ARMv8.0 kernel */
+#define __LSE_PREAMBLE  ".arch_extension lse\n"
+
+/* fetch_add: LDADD{A,AL} or an LL/SC add loop; returns the old value */
+#define __ARM64_FETCH_ADD(name, type, w, lse, ldx, stx, mb)                 \
+static inline type name(volatile type* p, type i) {                         \
+    type old, tmp;                                                          \
+    uint32_t fail;                                                          \
+    if (arm64_lse_atomics) {                                                \
+        __asm__ volatile(__LSE_PREAMBLE                                     \
+                         lse " %" w "[i], %" w "[old], %[v]\n"              \
+                         : [old] "=r"(old), [v] "+Q"(*p)                    \
+                         : [i] "r"(i)                                       \
+                         : "memory");                                       \
+    } else {                                                                \
+        __asm__ volatile("1: " ldx " %" w "[old], %[v]\n"                   \
+                         "   add %" w "[tmp], %" w "[old], %" w "[i]\n"     \
+                         "   " stx " %w[fail], %" w "[tmp], %[v]\n"         \
+                         "   cbnz %w[fail], 1b\n"                           \
+                         mb                                                 \
+                         : [old] "=&r"(old), [tmp] "=&r"(tmp),              \
+                           [fail] "=&r"(fail), [v] "+Q"(*p)                 \
+                         : [i] "r"(i)                                       \
+                         : "memory");                                       \
+    }                                                                       \
+    return old;                                                             \
+}
+
+/* xchg: SWPAL or an LL/SC loop; returns the old value */
+#define __ARM64_XCHG(name, type, w)                                         \
+static inline type name(volatile type* p, type i) {                         \
+    type old;                                                               \
+    uint32_t fail;                                                          \
+    if (arm64_lse_atomics) {                                                \
+        __asm__ volatile(__LSE_PREAMBLE                                     \
+                         "swpal %" w "[i], %" w "[old], %[v]\n"             \
+                         : [old] "=r"(old), [v] "+Q"(*p)                    \
+                         : [i] "r"(i)                                       \
+                         : "memory");                                       \
+    } else {                                                                \
+        __asm__ volatile("1: ldxr %" w "[old], %[v]\n"                      \
+                         "   stlxr %w[fail], %" w "[i], %[v]\n"             \
+                         "   cbnz %w[fail], 1b\n"                           \
+                         "   dmb ish\n"                                     \
+                         : [old] "=&r"(old), [fail] "=&r"(fail), [v] "+Q"(*p) \
+                         : [i] "r"(i)                                       \
+                         : "memory");                                       \
+    }                                                                       \
+    return old;                                                             \
+}
+
+/* cmpxchg: CASAL or an LL/SC loop; returns the value found (== old on success) */
+#define __ARM64_CMPXCHG(name, type, w)                                      \
+static inline type name(volatile type* p, type old, type new) {             \
+    type prev;                                                              \
+    uint32_t fail;                                                          \
+    if (arm64_lse_atomics) {                                                \
+        prev = old;                                                         \
+        __asm__ volatile(__LSE_PREAMBLE                                     \
+                         "casal %" w "[prev], %" w "[new], %[v]\n"          \
+                         : [prev] "+r"(prev), [v] "+Q"(*p)                  \
+                         : [new] "r"(new)                                   \
+                         : "memory");                                       \
+    } else {                                                                \
+        __asm__ volatile("1: ldxr %" w "[prev], %[v]\n"                     \
+                         "   cmp %" w "[prev], %" w "[old]\n"               \
+                         "   b.ne 2f\n"                                     \
+                         "   stlxr %w[fail], %" w "[new], %[v]\n"           \
+                         "   cbnz %w[fail], 1b\n"                           \
+                         "   dmb ish\n"                                     \
+                         "2:\n"                                             \
+                         : [prev] "=&r"(prev), [fail] "=&r"(fail), [v] "+Q"(*p) \
+                         : [old] "r"(old), [new] "r"(new)                   \
+                         : "cc", "memory");                                 \
+    }                                                                       \
+    return prev;                                                            \
+}
+
+__ARM64_FETCH_ADD(arch_atomic32_fetch_add, uint32_t, "w", "ldaddal", "ldxr", "stlxr", "   dmb ish\n")
+__ARM64_FETCH_ADD(arch_atomic64_fetch_add, uint64_t, "x", "ldaddal", "ldxr", "stlxr", "   dmb ish\n")
+__ARM64_FETCH_ADD(arch_atomic32_fetch_add_acquire, uint32_t, "w", "ldadda", "ldaxr", "stxr", "")
+__ARM64_FETCH_ADD(arch_atomic64_fetch_add_acquire, uint64_t, "x", "ldadda", "ldaxr", "stxr", "")
+__ARM64_XCHG(arch_atomic32_xchg, uint32_t, "w")
+__ARM64_XCHG(arch_atomic64_xchg, uint64_t, "x")
+__ARM64_CMPXCHG(arch_atomic32_cmpxchg, uint32_t, "w")
+__ARM64_CMPXCHG(arch_atomic64_cmpxchg, uint64_t, "x")
+
+#else /* x86_64: the builtins compile to single LOCK-prefixed instructions */
+
+#define __X86_ATOMIC_OPS(bits, type)                                        \
+static inline type arch_atomic##bits##_fetch_add(volatile type* p, type i) {          \
+    return __atomic_fetch_add(p, i, __ATOMIC_SEQ_CST);                      \
+}                                                                           \
+static inline type arch_atomic##bits##_fetch_add_acquire(volatile type* p, type i) {  \
+    return __atomic_fetch_add(p, i, __ATOMIC_ACQUIRE);                      \
+}                                                                           \
+static inline type arch_atomic##bits##_xchg(volatile type* p, type i) {               \
+    return __atomic_exchange_n(p, i, __ATOMIC_SEQ_CST);                     \
+}                                                                           \
+static inline type arch_atomic##bits##_cmpxchg(volatile type* p, type old, type new) { \
+    __atomic_compare_exchange_n(p, &old, new, false,                        \
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);        \
+    return old;                                                             \
+}
+
+__X86_ATOMIC_OPS(32, uint32_t)
+__X86_ATOMIC_OPS(64, uint64_t)
+
+#endif
+
+/******************************************************************************
+ * Atomic Counters
+ *****************************************************************************/
+
+typedef struct {
+    volatile int32_t counter;
+} atomic_t;
+
+typedef struct {
+    volatile int64_t counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(i)      { (i) }
+#define ATOMIC64_INIT(i)    { (i) }
+
+#define __ATOMIC_COUNTER_OPS(pfx, atype, type, utype, bits)                 \
+static inline type pfx##_read(const atype* v) {                             \
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);                  \
+}                                                                           \
+static inline void pfx##_set(atype* v, type i) {                            \
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);                     \
+}                                                                           \
+static inline type pfx##_read_acquire(const atype* v) {                     \
+    return __atomic_load_n(&v->counter, __ATOMIC_ACQUIRE);                  \
+}                                                                           \
+static inline void pfx##_set_release(atype* v, type i) {                    \
+    __atomic_store_n(&v->counter, i, __ATOMIC_RELEASE);                     \
+}                                                                           \
+static inline type pfx##_fetch_add(atype* v, type i) {                      \
+    return (type)arch_atomic##bits##_fetch_add((volatile utype*)&v->counter, (utype)i); \
+}                                                                           \
+static inline type pfx##_fetch_sub(atype* v, type i) {                      \
+    return pfx##_fetch_add(v, -i);                                          \
+}                                                                           \
+static inline type pfx##_add_return(atype* v, type i) {                     \
+    return pfx##_fetch_add(v, i) + i;                                       \
+}                                                                           \
+static inline type pfx##_sub_return(atype* v, type i) {                     \
+    return pfx##_fetch_add(v, -i) - i;                                      \
+}                                                                           \
+static inline void pfx##_inc(atype* v) {                                    \
+    pfx##_fetch_add(v, 1);                                                  \
+}                                                                           \
+static inline void pfx##_dec(atype* v) {                                    \
+    pfx##_fetch_add(v, -1);                                                 \
+}                                                                           \
+/* True if the decrement reached zero */                                    \
+static inline bool pfx##_dec_and_test(atype* v) {                           \
+    return pfx##_fetch_add(v, -1) == 1;                                     \
+}                                                                           \
+static inline type pfx##_xchg(atype* v, type i) {                           \
+    return (type)arch_atomic##bits##_xchg((volatile utype*)&v->counter, (utype)i); \
+}                                                                           \
+/* Returns the value found: the swap happened iff it equals old */          \
+static inline type pfx##_cmpxchg(atype* v, type old, type new) {            \
+    return (type)arch_atomic##bits##_cmpxchg((volatile utype*)&v->counter,  \
+                                             (utype)old, (utype)new);       \
+}
+
+__ATOMIC_COUNTER_OPS(atomic, atomic_t, int32_t, uint32_t, 32)
+__ATOMIC_COUNTER_OPS(atomic64, atomic64_t, int64_t, uint64_t, 64)
+
+#endif /* KERNEL_ATOMIC_H */
@@ -0,0 +1,97 @@
+/**
+ * In-kernel Benchmarks
+ *
+ * Built with KERNEL_BENCH defined (cmake -DKERNEL_BENCH=ON, or
+ * make -f Makefile.native BENCH=1), kernel_main starts the benchmark
+ * suite instead of the test tasks. Results go to the console, one
+ * record per line, so a run under QEMU can be diffed against a baseline:
+ *
+ *     BENCH_BEGIN arch=arm64 cpus=4 counter_hz=62500000
+ *     BENCH name=yield_pingpong_fifo unit=cycles samples=2000 min=.. p50=.. p99=.. max=.. mean=..
+ *     BENCH_HIST name=yield_pingpong_fifo lt=1024 count=1873
+ *     BENCH name=wakeup_latency_loaded_cpu1 unit=ns samples=2000 min=.. p50=.. p99=.. max=.. mean=..
+ *     BENCH_METRIC name=yield_storm_8 metric=switches_per_sec value=..
+ *     BENCH_END
+ *
+ * Cycles are CNTPCT_EL0 ticks on ARM64 (a fixed-frequency counter, not
+ * CPU cycles) and TSC cycles on x86_64; counter_hz converts them to time.
+ */
+
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+#include <kernel/types.h>
+#include <arch/cycles.h>
+
+/* Samples kept per histogram for exact percentiles */
+#ifndef BENCH_MAX_SAMPLES
+#define BENCH_MAX_SAMPLES   4096
+#endif
+
+/* Log2 buckets: bucket b counts samples in [2^(b-1), 2^b) (bucket 0: zero) */
+#define BENCH_HIST_BUCKETS  64
+
+/* Read the cycle counter (ordered against surrounding instructions) */
+static inline uint64_t bench_cycles(void) {
+    return arch_cycles();
+}
+
+typedef struct bench_hist {
+    const char* name;
+    const char* unit;           /* "cycles" unless the benchmark sets it */
+    uint64_t* samples;          /* First BENCH_MAX_SAMPLES samples */
+    uint32_t nr_samples;
+    uint64_t count;             /* All samples, including ones not kept */
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t buckets[BENCH_HIST_BUCKETS];
+} bench_hist_t;
+
+/**
+ * Set up a histogram (allocates its sample buffer)
+ * @return 0 on success, -1 if out of memory (adding and reporting still
+ *         work, the histogram just reports no samples)
+ */
+int bench_hist_init(bench_hist_t* hist, const char* name);
+
+/* Add one sample in hist->unit (not thread safe: one writer per histogram) */
+void bench_hist_add(bench_hist_t* hist, uint64_t cycles);
+
+/* Print the BENCH and BENCH_HIST lines and free the sample buffer */
+void bench_hist_report(bench_hist_t* hist);
+
+/* Print a BENCH_METRIC line */
+void bench_report_metric(const char* name, const char* metric, uint64_t value);
+
+/* Cycle counter frequency in Hz (measured against timer_get_ns() once) */
+uint64_t bench_counter_hz(void);
+
+/*
+ * Completion of a group of benchmark tasks: the runner sets the count,
+ * each task calls bench_sync_done() as its last step, and the runner
+ * blocks in bench_sync_wait() until all have.
+ */
+void bench_sync_init(uint32_t tasks);
+void bench_sync_done(void);
+void bench_sync_wait(void);
+
+/* The n-th online CPU counting down from the highest (wraps around), so
+ * benchmarks stay off CPU 0 and its device interrupts when they can */
+uint32_t bench_cpu(uint32_t n);
+
+/* Create a benchmark task, optionally SCHED_FIFO (rt_priority > 0) and
+ * bound to a CPU (cpu < MAX_CPUS), and make it runnable */
+struct task_struct* bench_spawn(const char* name, void (*entry)(void),
+                                uint8_t rt_priority, uint32_t cpu);
+
+/* Start the suite in its own task (kernel_main, KERNEL_BENCH builds) */
+void bench_start(void);
+
+/* Suites (bench runner task) */
+void sched_bench_run(void);
+void latency_bench_run(void);
+void hackbench_run(void);
+void fpu_bench_run(void);
+
+#endif /* KERNEL_BENCH_H */
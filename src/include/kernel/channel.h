@@ -0,0 +1,61 @@
+/**
+ * Channels - bounded message queues between tasks
+ *
+ * A channel carries fixed-size messages in FIFO order through a ring of
+ * capacity slots. Senders block while it is full and receivers while it
+ * is empty; any number of either may share one channel:
+ *
+ *     channel_t* ch = channel_create(sizeof(msg_t), 16);
+ *     channel_send(ch, &msg);                     (producer)
+ *     channel_recv(ch, &msg);                     (consumer)
+ *
+ * After channel_close() sends fail and receives drain what is left, then
+ * fail, so consumers see the end of the stream.
+ */
+
+#ifndef KERNEL_CHANNEL_H
+#define KERNEL_CHANNEL_H
+
+#include <kernel/types.h>
+#include <kernel/spinlock.h>
+#include <kernel/wait.h>
+
+typedef struct channel {
+    spinlock_t lock;            /* Protects the ring; taken with IRQs disabled */
+    uint8_t* buf;               /* capacity * msg_size bytes */
+    uint32_t msg_size;
+    uint32_t capacity;
+    uint32_t head;              /* Slot of the oldest message */
+    uint32_t count;             /* Messages queued */
+    bool closed;
+    wait_queue_head_t senders;  /* Waiting for a free slot */
+    wait_queue_head_t receivers;/* Waiting for a message */
+} channel_t;
+
+/**
+ * Create a channel
+ * @param msg_size - Bytes per message
+ * @param capacity - Messages it holds before senders block
+ * @return Channel, or NULL if out of memory
+ */
+channel_t* channel_create(uint32_t msg_size, uint32_t capacity);
+
+/* Free a channel nobody uses any more */
+void channel_destroy(channel_t* ch);
+
+/**
+ * Queue a copy of msg, blocking while the channel is full (task context)
+ * @return 0 on success, -1 if the channel is closed
+ */
+int channel_send(channel_t* ch, const void* msg);
+
+/**
+ * Take the oldest message, blocking while the channel is empty (task context)
+ * @return 0 on success, -1 if the channel is closed and empty
+ */
+int channel_recv(channel_t* ch, void* msg);
+
+/* Close the channel and wake everyone blocked on it */
+void channel_close(channel_t* ch);
+
+#endif /* KERNEL_CHANNEL_H */
@@ -0,0 +1,82 @@
+/**
+ * Kernel FP/SIMD Sections
+ *
+ * The kernel is built without FP/SIMD code generation, and FP/SIMD access
+ * is trapped (ARM64 CPACR_EL1.FPEN, x86_64 CR0.TS) outside explicit
+ * sections. Vectorized code lives in the files listed in
+ * KERNEL_SIMD_SOURCES (CMake) / KERNEL_SIMD_C (Makefile.native), the only
+ * ones built with SIMD enabled (kernel/simd.h), and is only called between
+ * kernel_fpu_begin() and kernel_fpu_end():
+ *
+ *     kernel_fpu_begin();
+ *     csum = simd_csum32(buf, len);
+ *     kernel_fpu_end();
+ *
+ * A task inside a section may be preempted or block: its registers are
+ * saved on switch-out and restored on switch-in. Tasks outside a section
+ * cost nothing at a context switch. Register contents are undefined on
+ * entry to a section; nested sections share one register set.
+ */
+
+#ifndef KERNEL_FPU_H
+#define KERNEL_FPU_H
+
+#include <kernel/types.h>
+
+/* Saved FP/SIMD registers of a task */
+#if defined(__x86_64__)
+typedef struct fpu_state {
+    uint8_t fxsave[512];        /* FXSAVE image: x87, MXCSR, XMM0-15 */
+} __attribute__((aligned(16))) fpu_state_t;
+#else
+typedef struct fpu_state {
+    uint64_t vregs[64];         /* V0-V31, 128 bits each */
+    uint32_t fpsr;
+    uint32_t fpcr;
+} __attribute__((aligned(16))) fpu_state_t;
+
+/* scheduler/fpu.S hard-codes this */
+_Static_assert(__builtin_offsetof(fpu_state_t, fpsr) == 512,
+               "FPU_FPSR_OFFSET in fpu.S is out of date");
+#endif
+
+struct task_struct;
+
+/**
+ * Enter / leave a section that may use FP/SIMD registers
+ * (task context only, not from IRQ handlers)
+ */
+void kernel_fpu_begin(void);
+void kernel_fpu_end(void);
+
+/**
+ * True if FP/SIMD may be used here (false in IRQ handlers)
+ */
+bool may_use_fpu(void);
+
+/**
+ * Context switch hook: save prev's registers and restore next's if they
+ * are inside a section (IRQs disabled, prev still current)
+ */
+void fpu_switch(struct task_struct* prev, struct task_struct* next);
+
+/* Architecture-specific */
+
+/**
+ * Set up the calling CPU's FP/SIMD unit with access trapped
+ * (once per CPU, before its first task switch)
+ */
+void fpu_init_cpu(void);
+
+/* Allow / trap FP/SIMD access on the calling CPU */
+void arch_fpu_enable(void);
+void arch_fpu_disable(void);
+
+/* Save / load the registers (access enabled) */
+void arch_fpu_save(fpu_state_t* state);
+void arch_fpu_restore(const fpu_state_t* state);
+
+/* Load the default control state (rounding, exception masks) */
+void arch_fpu_reset(void);
+
+#endif /* KERNEL_FPU_H */
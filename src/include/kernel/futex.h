@@ -0,0 +1,44 @@
+/**
+ * Futexes - sleep on the value of a 32-bit word
+ *
+ * A futex is any aligned uint32_t: synchronization objects keep their
+ * state in the word and update it with atomics (kernel/atomic.h), and
+ * only call into the scheduler when a task has to wait. A waiter passes
+ * the value it saw; futex_wait() re-reads the word under the bucket lock
+ * that futex_wake() also takes, so a wake that follows a change of the
+ * word cannot be missed:
+ *
+ *     while ((v = __atomic_load_n(&sem->count, __ATOMIC_ACQUIRE)) == 0) {
+ *         futex_wait(&sem->count, 0, 0);              (waiter)
+ *     }
+ *
+ *     __atomic_fetch_add(&sem->count, 1, __ATOMIC_RELEASE);
+ *     futex_wake(&sem->count, 1);                     (waker)
+ *
+ * Waiters are kept in a fixed hash table of buckets keyed by the word's
+ * address, so a futex needs no initialization or memory of its own.
+ */
+
+#ifndef KERNEL_FUTEX_H
+#define KERNEL_FUTEX_H
+
+#include <kernel/types.h>
+
+/**
+ * Block while *addr == expected, until futex_wake() on addr (task context)
+ * @param timeout_ns - Give up after this long; 0 waits forever
+ * @return 0 if woken, -1 if *addr != expected, -2 if the timeout expired
+ *         (callers re-check the word either way: wakeups may be spurious)
+ */
+int futex_wait(volatile uint32_t* addr, uint32_t expected, uint64_t timeout_ns);
+
+/**
+ * Wake up to nr tasks waiting on addr, oldest first (callable from IRQs)
+ * @return Number of tasks woken
+ */
+uint32_t futex_wake(volatile uint32_t* addr, uint32_t nr);
+
+/* Internal: Set up the bucket table (scheduler_init) */
+void futex_init(void);
+
+#endif /* KERNEL_FUTEX_H */
@@ -0,0 +1,134 @@
+/**
+ * High-Resolution Timers
+ *
+ * Nanosecond timers kept in a per-CPU queue ordered by expiry. The CPU's
+ * timer hardware runs one-shot, always programmed for the earliest
+ * expiry, and callbacks run from the timer interrupt. The scheduler tick
+ * is one of these timers (see kernel/tick.h).
+ */
+
+#ifndef KERNEL_HRTIMER_H
+#define KERNEL_HRTIMER_H
+
+#include <kernel/types.h>
+#include <kernel/rbtree.h>
+
+/* "No expiry": nothing to program */
+#define HRTIMER_NO_EXPIRY   0xFFFFFFFFFFFFFFFFULL
+
+#define NSEC_PER_USEC       1000ULL
+#define NSEC_PER_MSEC       1000000ULL
+#define NSEC_PER_SEC        1000000000ULL
+
+/* Callback result */
+typedef enum {
+    HRTIMER_NORESTART,      /* Done */
+    HRTIMER_RESTART         /* Requeue with the (forwarded) expiry */
+} hrtimer_restart_t;
+
+/* How hrtimer_start() interprets its time argument */
+typedef enum {
+    HRTIMER_MODE_ABS,       /* Absolute timer_get_ns() time */
+    HRTIMER_MODE_REL        /* Relative to now */
+} hrtimer_mode_t;
+
+struct hrtimer;
+struct hrtimer_base;
+
+/* Runs in interrupt context, IRQs disabled, on the CPU the timer was queued on */
+typedef hrtimer_restart_t (*hrtimer_fn_t)(struct hrtimer* timer);
+
+typedef struct hrtimer {
+    rb_node_t node;                 /* Node in the base's expiry-ordered tree */
+    uint64_t expires;               /* Absolute expiry (ns) */
+    hrtimer_fn_t function;
+    void* data;                     /* Owner's context for the callback */
+    struct hrtimer_base* base;      /* Per-CPU queue it belongs to (NULL: never started) */
+    bool queued;
+} hrtimer_t;
+
+/* Scale a counter: (value * mult) >> 32, without overflowing 64 bits */
+static inline uint64_t clock_scale(uint64_t value, uint64_t mult) {
+    return (uint64_t)(((unsigned __int128)value * mult) >> 32);
+}
+
+/**
+ * Initialize a timer (not started)
+ * @param timer - Timer
+ * @param function - Callback
+ * @param data - Stored in timer->data for the callback
+ */
+void hrtimer_init(hrtimer_t* timer, hrtimer_fn_t function, void* data);
+
+/**
+ * (Re)start a timer on the calling CPU
+ * Starting a queued timer moves it. Callers must not start or cancel the
+ * same timer concurrently from several CPUs.
+ * @param timer - Timer
+ * @param time - Expiry in ns (absolute or relative, see mode)
+ * @param mode - HRTIMER_MODE_ABS or HRTIMER_MODE_REL
+ */
+void hrtimer_start(hrtimer_t* timer, uint64_t time, hrtimer_mode_t mode);
+
+/**
+ * Cancel a timer, waiting for its callback if it is running right now
+ * Must not be called from the timer's own callback.
+ * @return true if the timer was queued
+ */
+bool hrtimer_cancel(hrtimer_t* timer);
+
+/**
+ * Cancel a timer without waiting
+ * @return 1 if it was queued, 0 if it was not, -1 if its callback is running
+ */
+int hrtimer_try_to_cancel(hrtimer_t* timer);
+
+/**
+ * Check whether a timer is queued
+ */
+bool hrtimer_active(const hrtimer_t* timer);
+
+/**
+ * Push a timer's expiry forward by whole intervals until it is after now
+ * (for periodic timers, from the callback before returning HRTIMER_RESTART)
+ * @return Number of intervals added (0 if it had not expired yet)
+ */
+uint64_t hrtimer_forward(hrtimer_t* timer, uint64_t now, uint64_t interval);
+
+/**
+ * Earliest expiry queued on the calling CPU, ignoring one timer
+ * @param exclude - Timer to ignore (may be NULL)
+ * @return Absolute expiry, or HRTIMER_NO_EXPIRY
+ */
+uint64_t hrtimer_get_next_event(const hrtimer_t* exclude);
+
+/**
+ * Make the calling CPU's queue usable (its timer hardware is ready)
+ */
+void hrtimer_init_cpu(void);
+
+/**
+ * Run expired timers and reprogram the hardware (timer interrupt, IRQs off)
+ */
+void hrtimer_interrupt(void);
+
+/**
+ * Busy-wait for a short time (ns resolution)
+ * @param ns - Nanoseconds
+ */
+void ndelay(uint64_t ns);
+
+/* Architecture timer driver */
+
+/**
+ * Monotonic time since boot in nanoseconds (ARM64: CNTPCT_EL0, x86_64: TSC)
+ */
+uint64_t timer_get_ns(void);
+
+/**
+ * Program the calling CPU's one-shot timer interrupt
+ * @param expires_ns - Absolute time (past: fire now; HRTIMER_NO_EXPIRY: disarm)
+ */
+void timer_set_next_event(uint64_t expires_ns);
+
+#endif /* KERNEL_HRTIMER_H */
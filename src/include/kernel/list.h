@@ -0,0 +1,74 @@
+/**
+ * Generic Doubly Linked List
+ * Intrusive circular list (embed list_head_t in your struct)
+ */
+
+#ifndef KERNEL_LIST_H
+#define KERNEL_LIST_H
+
+#include <kernel/types.h>
+
+/* List node / list head - an empty list points at itself */
+typedef struct list_head {
+    struct list_head* next;
+    struct list_head* prev;
+} list_head_t;
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+/* Get the containing structure from an embedded list_head_t */
+#define list_entry(ptr, type, member) \
+    ((type*)((uint8_t*)(ptr) - __builtin_offsetof(type, member)))
+
+#define list_first_entry(head, type, member) \
+    list_entry((head)->next, type, member)
+
+static inline void list_init(list_head_t* head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline bool list_empty(const list_head_t* head) {
+    return head->next == head;
+}
+
+/* Link node between two adjacent entries */
+static inline void list_insert(list_head_t* node, list_head_t* prev, list_head_t* next) {
+    next->prev = node;
+    node->next = next;
+    node->prev = prev;
+    prev->next = node;
+}
+
+/* Add node at the front of the list */
+static inline void list_add(list_head_t* node, list_head_t* head) {
+    list_insert(node, head, head->next);
+}
+
+/* Add node at the back of the list */
+static inline void list_add_tail(list_head_t* node, list_head_t* head) {
+    list_insert(node, head->prev, head);
+}
+
+/* Unlink node; it becomes an empty list of its own */
+static inline void list_del(list_head_t* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    list_init(node);
+}
+
+/* Move all entries of list to head (previous contents of head are dropped);
+ * list is left empty */
+static inline void list_move_all(list_head_t* list, list_head_t* head) {
+    if (list_empty(list)) {
+        list_init(head);
+        return;
+    }
+    head->next = list->next;
+    head->prev = list->prev;
+    head->next->prev = head;
+    head->prev->next = head;
+    list_init(list);
+}
+
+#endif /* KERNEL_LIST_H */
@@ -26,6 +26,20 @@ void* pmm_alloc_page(void);
  */
 void pmm_free_page(void* page);
 
+/**
+ * Allocate physically contiguous pages
+ * @param count - Number of 4KB pages
+ * @return Physical address of the first page, or 0 if no run is free
+ */
+void* pmm_alloc_pages(uint64_t count);
+
+/**
+ * Free pages allocated with pmm_alloc_pages()
+ * @param pages - Physical address of the first page
+ * @param count - Number of pages (as allocated)
+ */
+void pmm_free_pages_at(void* pages, uint64_t count);
+
 /**
  * Get the number of free pages available
  * @return Number of free 4KB pages
@@ -76,4 +90,39 @@ void kmalloc_init(void* heap_start, size_t heap_size);
  */
 void kmalloc_stats(uint64_t* total, uint64_t* used, uint64_t* free);
 
+/* Kernel Stack Cache */
+
+/* Standard stack sizes; requests are rounded up to the next one */
+#define STACK_SIZE_MIN      (4 * 1024U)
+#define STACK_SIZE_MAX      (16 * 1024U)
+
+/**
+ * Allocate a page-aligned kernel stack from this CPU's cache
+ * @param size - Requested size in bytes; rounded up to 4, 8 or 16 KB
+ *               (larger sizes come straight from the page allocator)
+ * @return Stack base (lowest address), or NULL if out of memory
+ */
+void* stack_alloc(uint32_t size);
+
+/**
+ * Return a stack to this CPU's cache
+ * @param stack - Stack base returned by stack_alloc()
+ * @param size - Size as passed to stack_alloc()
+ */
+void stack_free(void* stack, uint32_t size);
+
+/**
+ * Size stack_alloc() actually allocates for a request
+ * @param size - Requested size in bytes
+ * @return Rounded size in bytes
+ */
+uint32_t stack_size_round(uint32_t size);
+
+/**
+ * Get stack cache statistics (summed over all CPUs)
+ * @param cached - Stacks sitting in the caches (can be NULL)
+ * @param in_use - Stacks handed out and not freed yet (can be NULL)
+ */
+void stack_cache_stats(uint64_t* cached, uint64_t* in_use);
+
 #endif // ZIXIAO_MM_H
@@ -0,0 +1,65 @@
+/**
+ * Mutexes - sleeping mutual exclusion between tasks
+ *
+ * An uncontended lock or unlock is one compare-and-swap of the owner
+ * word. A task that finds the mutex taken spins while the owner is
+ * running on another CPU (it is likely to release the mutex soon), and
+ * otherwise blocks until the owner hands the mutex over:
+ *
+ *     static mutex_t table_lock = MUTEX_INIT(table_lock);
+ *
+ *     mutex_lock(&table_lock);
+ *     ... may sleep, allocate, wait ...
+ *     mutex_unlock(&table_lock);
+ *
+ * Priority inheritance: while a higher-priority task waits, the owner
+ * runs at the waiter's priority (as SCHED_FIFO), through a chain of
+ * owners blocked on further mutexes, so a preempted low-priority owner
+ * cannot hold a real-time waiter up. The unlock that ends the boost
+ * drops the owner back to its own policy and reschedules if another
+ * task now outranks it. Deadline owners keep their class; a deadline
+ * waiter boosts to the top real-time priority.
+ *
+ * Task context only: a mutex may not be taken in IRQ handlers or with
+ * a spinlock held, and only its owner may release it.
+ */
+
+#ifndef KERNEL_MUTEX_H
+#define KERNEL_MUTEX_H
+
+#include <kernel/types.h>
+#include <kernel/list.h>
+#include <kernel/sched.h>
+
+/* Set in owner while tasks are queued: lock and unlock take the slow path */
+#define MUTEX_HAS_WAITERS   1ULL
+
+typedef struct mutex {
+    volatile uint64_t owner;    /* Owning task_struct_t* | MUTEX_HAS_WAITERS, 0 if free */
+    list_head_t waiters;        /* Blocked tasks, oldest first */
+    list_head_t held_node;      /* In the owner's pi_held while there are waiters */
+} mutex_t;
+
+#define MUTEX_INIT(name) { 0, LIST_HEAD_INIT((name).waiters), LIST_HEAD_INIT((name).held_node) }
+
+void mutex_init(mutex_t* lock);
+
+/* Acquire, spinning or sleeping until the mutex is free */
+void mutex_lock(mutex_t* lock);
+
+/* Acquire if the mutex is free; returns true if it was taken */
+bool mutex_trylock(mutex_t* lock);
+
+/* Release and hand the mutex to the highest-priority waiter */
+void mutex_unlock(mutex_t* lock);
+
+/* True if some task holds the mutex */
+static inline bool mutex_is_locked(mutex_t* lock) {
+    return (lock->owner & ~MUTEX_HAS_WAITERS) != 0;
+}
+
+/* Internal: Re-evaluate the boost of task and of the owners it waits on
+ * after its own priority changed (sched_setscheduler*) */
+void mutex_pi_adjust(task_struct_t* task);
+
+#endif /* KERNEL_MUTEX_H */
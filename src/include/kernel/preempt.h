@@ -0,0 +1,88 @@
+/**
+ * Kernel Preemption
+ *
+ * Each CPU has a preempt_count: the low 16 bits count nested
+ * preempt_disable() sections, the bits above count nested hard IRQs.
+ * The running task can only be switched out involuntarily while the
+ * count is zero: on the way out of an interrupt (after EOI, once the
+ * outermost handler has returned) or at preempt_enable(), whenever
+ * need_resched was set by the tick or by a wakeup.
+ */
+
+#ifndef KERNEL_PREEMPT_H
+#define KERNEL_PREEMPT_H
+
+#include <kernel/types.h>
+#include <kernel/smp.h>
+
+#define PREEMPT_OFFSET      0x00001U
+#define HARDIRQ_OFFSET      0x10000U
+#define PREEMPT_MASK        0x0FFFFU
+#define HARDIRQ_MASK        0xF0000U
+
+/* Modify this CPU's count without racing a migration: the task must not
+ * move between finding its per-CPU area and writing it */
+static inline void preempt_count_add(uint32_t val) {
+#if defined(__aarch64__)
+    uint64_t daif;
+    __asm__ volatile("mrs %0, daif\n"
+                     "msr daifset, #2"
+                     : "=r"(daif) :: "memory");
+    this_cpu()->preempt_count += val;
+    __asm__ volatile("msr daif, %0" :: "r"(daif) : "memory");
+#else
+    /* One instruction: an IRQ cannot split it */
+    __asm__ volatile("addl %0, %%gs:%c1"
+                     :: "ri"(val), "i"(CPU_LOCAL_PREEMPT_COUNT) : "memory", "cc");
+#endif
+}
+
+static inline void preempt_count_sub(uint32_t val) {
+    preempt_count_add(-val);
+}
+
+static inline uint32_t preempt_count(void) {
+    return __atomic_load_n(&this_cpu()->preempt_count, __ATOMIC_RELAXED);
+}
+
+/* True inside a hard IRQ handler */
+static inline bool in_irq(void) {
+    return (preempt_count() & HARDIRQ_MASK) != 0;
+}
+
+/* Reschedule now if allowed (count zero, IRQs enabled); see sched.c */
+void preempt_schedule(void);
+
+/* Act on a pending need_resched if preemption is enabled */
+static inline void preempt_check_resched(void) {
+    cpu_local_t* cpu = this_cpu();
+    if (cpu->need_resched && cpu->preempt_count == 0) {
+        preempt_schedule();
+    }
+}
+
+static inline void preempt_disable(void) {
+    preempt_count_add(PREEMPT_OFFSET);
+}
+
+/* Leaving the last section is a preemption point */
+static inline void preempt_enable(void) {
+    preempt_count_sub(PREEMPT_OFFSET);
+    preempt_check_resched();
+}
+
+static inline void preempt_enable_no_resched(void) {
+    preempt_count_sub(PREEMPT_OFFSET);
+}
+
+/* Bracket a hard IRQ handler: no preemption until the outermost one
+ * has returned to the IRQ exit path */
+static inline void hardirq_enter(void) {
+    preempt_count_add(HARDIRQ_OFFSET);
+}
+
+static inline void hardirq_exit(void) {
+    preempt_count_sub(HARDIRQ_OFFSET);
+}
+
+#endif /* KERNEL_PREEMPT_H */
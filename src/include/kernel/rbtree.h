@@ -0,0 +1,74 @@
+/**
+ * Generic Red-Black Tree
+ * Intrusive balanced binary search tree (embed rb_node_t in your struct)
+ */
+
+#ifndef KERNEL_RBTREE_H
+#define KERNEL_RBTREE_H
+
+#include <kernel/types.h>
+
+#define RB_RED      0
+#define RB_BLACK    1
+
+/* Tree node - embedded in the containing structure */
+typedef struct rb_node {
+    struct rb_node* parent;
+    struct rb_node* left;
+    struct rb_node* right;
+    uint8_t color;              /* RB_RED or RB_BLACK */
+} rb_node_t;
+
+/* Tree root with cached leftmost (smallest) node for O(1) rb_first_cached() */
+typedef struct rb_root {
+    rb_node_t* node;
+    rb_node_t* leftmost;
+} rb_root_t;
+
+/* Ordering callback: return true if a sorts before b */
+typedef bool (*rb_less_t)(const rb_node_t* a, const rb_node_t* b);
+
+#define RB_ROOT_INIT    { NULL, NULL }
+#define RB_EMPTY(root)  ((root)->node == NULL)
+
+/* Get the containing structure from an embedded rb_node_t */
+#define rb_entry(ptr, type, member) \
+    ((type*)((uint8_t*)(ptr) - __builtin_offsetof(type, member)))
+
+/**
+ * Insert a node into the tree - O(log n)
+ * Equal keys are inserted after existing ones (FIFO among equals)
+ * @param root - Tree root
+ * @param node - Node to insert (must not already be in a tree)
+ * @param less - Ordering callback
+ */
+void rb_insert(rb_root_t* root, rb_node_t* node, rb_less_t less);
+
+/**
+ * Remove a node from the tree - O(log n)
+ * @param root - Tree root
+ * @param node - Node to remove (must be in this tree)
+ */
+void rb_delete(rb_root_t* root, rb_node_t* node);
+
+/**
+ * Get the smallest node by walking the left spine - O(log n)
+ * @return Leftmost node, or NULL if tree is empty
+ */
+rb_node_t* rb_first(const rb_root_t* root);
+
+/**
+ * Get the in-order successor of a node - amortized O(1)
+ * @return Next node, or NULL if node is the last one
+ */
+rb_node_t* rb_next(const rb_node_t* node);
+
+/**
+ * Get the smallest node from the cache - O(1)
+ * @return Leftmost node, or NULL if tree is empty
+ */
+static inline rb_node_t* rb_first_cached(const rb_root_t* root) {
+    return root->leftmost;
+}
+
+#endif /* KERNEL_RBTREE_H */
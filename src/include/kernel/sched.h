@@ -7,6 +7,11 @@
 #define KERNEL_SCHED_H
 
 #include <kernel/types.h>
+#include <kernel/list.h>
+#include <kernel/rbtree.h>
+#include <kernel/spinlock.h>
+#include <kernel/hrtimer.h>
+#include <kernel/fpu.h>
 
 /* Task states */
 typedef enum {
@@ -14,14 +19,18 @@ typedef enum {
     TASK_READY,      /* Ready to run */
     TASK_BLOCKED,    /* Waiting for resource */
     TASK_SLEEPING,   /* Sleeping until timer */
-    TASK_ZOMBIE      /* Exited, waiting for cleanup */
+    TASK_ZOMBIE,     /* Exited, waiting for the reaper */
+    TASK_DEAD        /* Reaped: free task_table slot */
 } task_state_t;
 
 /* Scheduling policies */
 typedef enum {
-    SCHED_FIFO = 0,     /* Real-time FIFO */
-    SCHED_RR = 1,       /* Real-time Round-Robin */
-    SCHED_NORMAL = 2    /* Normal priority-based */
+    SCHED_FIFO = 0,     /* Real-time FIFO (runs until it blocks, yields or is preempted) */
+    SCHED_RR = 1,       /* Real-time Round-Robin (FIFO with a time slice) */
+    SCHED_NORMAL = 2,   /* Normal (CFS, weighted fair share) */
+    SCHED_DEADLINE = 3, /* Earliest deadline first with a bandwidth budget (runs before RT) */
+    SCHED_BATCH = 4,    /* CFS share, but longer slices and no wakeup preemption */
+    SCHED_IDLE = 5      /* Background: runs only when a CPU would otherwise idle */
 } sched_policy_t;
 
 
@@ -35,6 +44,19 @@ typedef enum {
  */
 
 /* CPU context saved during context switch */
+#if defined(__x86_64__)
+typedef struct cpu_context {
+    uint64_t rbx;
+    uint64_t rbp;
+    uint64_t r12;
+    uint64_t r13;
+    uint64_t r14;
+    uint64_t r15;
+    uint64_t rip;   /* Resume address */
+    uint64_t rsp;   /* Saved stack pointer */
+    uint64_t reserved[5];   /* Same size as ARM64: task_struct offsets are shared */
+} cpu_context_t;
+#else
 typedef struct cpu_context {
     uint64_t x19;
     uint64_t x20;
@@ -50,6 +72,9 @@ typedef struct cpu_context {
     uint64_t pc;    /* x30/LR - program counter */
     uint64_t sp;    /* Saved stack pointer */
 } cpu_context_t;
+#endif
+
+struct sched_class;     /* kernel/sched_class.h */
 
 /* Task structure (Process Control Block) */
 typedef struct task_struct {
@@ -77,36 +102,233 @@ typedef struct task_struct {
     void* kernel_stack;         /* Stack base address */
     uint32_t kernel_stack_size; /* Stack size in bytes */
 
-    /* List linkage */
+    /*
+     * Fields below are not referenced from assembly. Everything above must
+     * keep its layout: context_switch.S hard-codes CPU_CONTEXT_OFFSET and
+     * the kernel_stack offsets.
+     */
+
+    /* Runqueue linkage */
+    const struct sched_class* sched_class;  /* Class implementing policy */
+    rb_node_t run_node;         /* Node in runqueue timeline (keyed by vruntime,
+                                 * or by deadline in the deadline tree) */
+    uint64_t prev_sum_exec_runtime; /* sum_exec_runtime when last picked */
+    bool on_rq;                 /* Accounted in runqueue (queued or running) */
+    uint32_t cpu;               /* CPU whose runqueue holds (or last held) the task */
+    volatile bool on_cpu;       /* Executing (or being switched out) on cpu */
+    uint64_t last_ran;          /* Runqueue clock when last switched out (cache hotness) */
+    uint64_t nr_migrations;     /* Times moved to another CPU's runqueue */
+    bool cpu_bound;             /* Never leaves cpu (task_bind_cpu) */
+    spinlock_t pi_lock;         /* Serializes wakeups of this task */
+
+    /* Real-time class (SCHED_FIFO / SCHED_RR) */
+    list_head_t run_list;       /* Node in the runqueue's per-priority FIFO list */
+    uint8_t rt_priority;        /* 0 .. MAX_RT_PRIO-1, higher runs first */
+
+    /* Deadline class (SCHED_DEADLINE); ns on the timer_get_ns() clock */
+    uint64_t dl_runtime;        /* Budget per period */
+    uint64_t dl_deadline;       /* Relative deadline */
+    uint64_t dl_period;         /* Period */
+    uint64_t dl_bw;             /* dl_runtime / dl_period (SCHED_DL_BW_SHIFT fixed point) */
+    uint64_t deadline;          /* Absolute deadline of the current instance */
+    int64_t runtime;            /* Budget left in the current instance */
+    uint64_t dl_exec_start;     /* When runtime was last charged (while running) */
+    bool dl_throttled;          /* Out of budget until dl_timer replenishes it */
+    bool dl_missed;             /* Current instance already counted as a miss */
+    hrtimer_t dl_timer;         /* Replenishment at the start of the next period */
+    uint64_t dl_misses;         /* Instances still runnable past their deadline */
+    uint64_t dl_overruns;       /* Instances throttled for using up their budget */
+
+    /* List linkage (next: free slot list while TASK_DEAD) */
     struct task_struct* next;
     struct task_struct* prev;
 
     /* Statistics */
     uint64_t switches;          /* Context switch count */
+
+    /* FP/SIMD (kernel/fpu.h): saved only while inside a section */
+    uint32_t fpu_depth;         /* Nested kernel_fpu_begin() sections */
+    fpu_state_t fpu;            /* Registers while switched out in a section */
+
+    /* Priority inheritance (kernel/mutex.h) */
+    uint8_t normal_policy;      /* Policy and priority set by sched_setscheduler*(); */
+    uint8_t normal_rt_priority; /* policy/rt_priority differ only while boosted */
+    bool pi_boosted;            /* Running at a waiter's priority */
+    list_head_t pi_held;        /* Owned mutexes that have waiters */
+    struct mutex* blocked_on;   /* Mutex this task waits for */
 } task_struct_t;
 
-/* Maximum number of tasks */
-#define MAX_TASKS 256
+/* Maximum number of tasks (task_table slots, idle tasks included) */
+#define MAX_TASKS 512
+
+/* PIDs are 1 .. PID_MAX-1 (0 is the idle tasks'); a multiple of 64, at
+ * most 4096, and larger than MAX_TASKS so freed PIDs are not reused at once */
+#define PID_MAX 4096
 
 /* Default time slice (10 ticks = 100ms at 100Hz) */
 #define DEFAULT_TIMESLICE 10
 
+/* Scheduler tick length in nanoseconds (matches TIMER_TICK_HZ = 100) */
+#define SCHED_TICK_NS               10000000ULL
+
+/* CFS tunables (nanoseconds) */
+#define SCHED_LATENCY_NS            40000000ULL  /* Target period for all runnable tasks */
+#define SCHED_MIN_GRANULARITY_NS    10000000ULL  /* Minimum slice per task */
+#define SCHED_WAKEUP_GRANULARITY_NS 10000000ULL  /* vruntime lead needed to preempt on wakeup */
+#define SCHED_BATCH_MIN_SLICE_NS    40000000ULL  /* Minimum slice of a SCHED_BATCH task */
+
+/* Number of real-time priority levels (one bit each in a 64-bit bitmap) */
+#define MAX_RT_PRIO 64
+
+/* SCHED_DEADLINE bandwidth: fixed point fraction of one CPU */
+#define SCHED_DL_BW_SHIFT           20
+#define SCHED_DL_BW_LIMIT           ((95ULL << SCHED_DL_BW_SHIFT) / 100)  /* Per CPU */
+#define SCHED_DL_MIN_RUNTIME_NS     10000ULL     /* Smallest budget worth enforcing */
+#define SCHED_DL_MAX_PERIOD_NS      (1ULL << 40) /* Keeps the bandwidth shift in 64 bits */
+
+/* Weight of a priority-5 (nice 0) task */
+#define NICE_0_WEIGHT 1024
+
+/* Load weight of a SCHED_IDLE task (hardly counts when balancing) */
+#define WEIGHT_IDLEPRIO 3
+
+/* Load balancing tunables */
+#define SCHED_BALANCE_INTERVAL_TICKS 4              /* Periodic balance of a busy CPU */
+#define SCHED_MIGRATION_COST_NS     SCHED_TICK_NS   /* Ran this recently = cache hot */
+#define SCHED_BALANCE_MAX_MOVE      8               /* Tasks pulled per balance pass */
+
+/* Per-CPU load balancing counters */
+typedef struct sched_balance_stats {
+    uint64_t balance_runs;      /* Periodic balance passes */
+    uint64_t idle_balance_runs; /* Balance passes on entering idle */
+    uint64_t steal_attempts;    /* Tries to pull from the busiest runqueue */
+    uint64_t steal_success;     /* Tries that pulled at least one task */
+    uint64_t migrations_in;     /* Tasks pulled to this CPU */
+    uint64_t migrations_out;    /* Tasks pulled away from this CPU */
+    uint64_t wake_affine;       /* Wakeups placed on the waker's CPU */
+    uint64_t wake_prev;         /* Wakeups placed on the task's previous CPU */
+    uint64_t nohz_kicks;        /* Tickless idle CPUs woken to pull from this one */
+} sched_balance_stats_t;
+
 /* Scheduler API */
 void scheduler_init(void);
+void scheduler_init_cpu(void);         /* Per-CPU setup; caller becomes the idle task */
 void scheduler_tick(void);
 void schedule(void);
 task_struct_t* get_current_task(void);
 void task_ready(task_struct_t* task);  /* Add task to ready queue */
+bool wake_up_process(task_struct_t* task); /* Wake a TASK_BLOCKED/TASK_SLEEPING task */
+void preempt_schedule_irq(void);       /* IRQ exit preemption (see kernel/preempt.h) */
+bool scheduler_need_resched(void);     /* True if current task should be switched out */
+
+/* Change policy (SCHED_FIFO/SCHED_RR with rt_priority, or SCHED_NORMAL,
+ * SCHED_BATCH, SCHED_IDLE with rt_priority 0)
+ * Returns 0 on success, -1 on invalid arguments */
+int sched_setscheduler(task_struct_t* task, uint8_t policy, uint8_t rt_priority);
+
+/* Make task SCHED_DEADLINE: runtime ns of CPU every period ns, finished
+ * within deadline ns of the period start (runtime <= deadline <= period).
+ * The bandwidth is reserved on one CPU, which the task then stays on.
+ * Returns 0 on success, -1 on invalid arguments, -2 if no CPU has enough
+ * unreserved bandwidth */
+int sched_setscheduler_dl(task_struct_t* task, uint64_t runtime_ns,
+                          uint64_t deadline_ns, uint64_t period_ns);
+
+/* Keep a task that has not been made runnable yet on one CPU for good
+ * (benchmarks, per-CPU workers)
+ * Returns 0 on success, -1 if cpu is offline or the task already runs */
+int task_bind_cpu(task_struct_t* task, uint32_t cpu);
 
-/* Scheduler time source (for CFS vruntime calculations) */
+/* Priority inheritance: run task at policy/rt_priority (boosted) or at
+ * its own policy again (!boosted); kernel/mutex.h only */
+void sched_pi_setprio(task_struct_t* task, uint8_t policy, uint8_t rt_priority, bool boosted);
+
+/* Dynamic tick support (see kernel/tick.h; IRQs disabled, calling CPU) */
+bool sched_can_stop_tick(void);        /* Nothing queued: tick may stop */
+void sched_nohz_enter(void);           /* Tick stopped: other CPUs must kick us */
+void sched_nohz_exit(uint64_t ticks);  /* Tick restarted: catch up the clock */
+
+/* Load balancing statistics */
+void sched_get_balance_stats(uint32_t cpu, sched_balance_stats_t* stats);
+void sched_print_balance_stats(void);
+
+/* Runqueue lock contention (LOCK_STATS lines; SPINLOCK_STATS builds only) */
+void sched_print_lock_stats(void);
+
+/* Deadline class: reserved bandwidth per CPU, misses and overruns per task */
+void sched_print_dl_stats(void);
+
+/* Scheduler time source in nanoseconds (for CFS vruntime calculations) */
 uint64_t scheduler_get_time(void);
 
 /* Task creation/destruction */
 task_struct_t* task_create(const char* name, void (*entry)(void),
                            uint8_t priority, uint32_t stack_size);
+
+/* Create a task with a non-real-time policy: SCHED_NORMAL, SCHED_BATCH
+ * or SCHED_IDLE (real-time and deadline tasks need sched_setscheduler*) */
+task_struct_t* task_create_policy(const char* name, void (*entry)(void), uint8_t priority,
+                                  uint8_t policy, uint32_t stack_size);
 void task_exit(void);
 void task_yield(void);
 
+/* Live task with the given PID, or NULL (O(1)) */
+task_struct_t* find_task_by_pid(uint32_t pid);
+
+/* Number of task slots in use, idle tasks included */
+uint32_t task_count(void);
+
+/* Stack usage profiling: deepest stack use of a task so far (bytes), and
+ * a report of the deepest use per task name, exited tasks included
+ * (task context) */
+uint32_t stack_usage(task_struct_t* task);
+void stack_usage_report(void);
+
+/* Sleep at least ns nanoseconds (task context only, not the idle task) */
+void task_sleep_ns(uint64_t ns);
+
+/* Sleep until the absolute timer_get_ns() time deadline_ns, so periodic
+ * tasks do not drift by their own wakeup latency (same restrictions) */
+void task_sleep_until(uint64_t deadline_ns);
+
+/* Sleep until woken or timeout_ns elapsed; the caller sets its state first
+ * Returns the time left (0 if the timeout expired) */
+uint64_t schedule_timeout(uint64_t timeout_ns);
+
+/* Set the current task's state before checking a wait condition
+ * (full barrier: the check cannot be reordered before the store) */
+#define set_current_state(state_value) do {                 \
+        get_current_task()->state = (state_value);          \
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);            \
+    } while (0)
+
+/* Internal: Reset task slots and PIDs (scheduler_init) */
+void task_table_init(void);
+
+/* Internal: Free an exited task's stack, slot and PID (finish_task_switch) */
+void task_reap(task_struct_t* task);
+
+/* Internal: Paint a new stack / record its usage before it is freed */
+void stack_paint(void* stack, uint32_t size);
+void stack_usage_record(task_struct_t* task);
+
+/* Internal: Stack usage of the live task in a task_table slot, taken under
+ * the task table lock; false if the slot holds none (stack_usage_report) */
+bool task_stack_sample(uint32_t slot, char name[16], uint32_t* used, uint32_t* size);
+
+/* Internal: Create the idle task for the calling CPU (adopts its current stack) */
+task_struct_t* task_create_idle(void);
+
+/* Internal: Finish a context switch in a new task (called from ret_from_fork) */
+void schedule_tail(void);
+
+/* Internal: Initialize scheduling fields of a new task (weight, vruntime) */
+void sched_task_init(task_struct_t* task);
+
+/* Idle task: loop of cpu_idle(), which sleeps until the next interrupt */
+void idle_task_entry(void);
+void cpu_idle(void);
+
 /* Internal: Pick next task to run */
 task_struct_t* pick_next_task(void);
 
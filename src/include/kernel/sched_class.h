@@ -0,0 +1,254 @@
+/**
+ * Scheduling Classes - scheduler internals
+ *
+ * Each policy is implemented by a class with its own runqueue structure:
+ * deadline (EDF tree), real-time (priority array), fair (vruntime tree),
+ * background (FIFO list) and idle. Classes are chained from highest to
+ * lowest; the core picks from the highest class whose bit is set in
+ * rq->queued_mask, so it never looks at classes with nothing queued. Only
+ * kernel/scheduler/ includes this header.
+ */
+
+#ifndef KERNEL_SCHED_CLASS_H
+#define KERNEL_SCHED_CLASS_H
+
+#include <kernel/types.h>
+#include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+#include <kernel/rbtree.h>
+#include <kernel/hrtimer.h>
+
+/*
+ * Real-time priority array: one FIFO list per priority plus a bitmap of
+ * the non-empty lists, so the highest queued priority is 63 - clz(bitmap).
+ */
+typedef struct rt_rq {
+    uint64_t bitmap;                    /* Bit p set = queue[p] non-empty */
+    list_head_t queue[MAX_RT_PRIO];     /* Ready tasks per priority, FIFO order */
+} rt_rq_t;
+
+/*
+ * Deadline runqueue: ready SCHED_DEADLINE tasks ordered by absolute
+ * deadline, leftmost cached. A throttled task stays on_rq but is kept out
+ * of the tree until its replenishment timer fires.
+ */
+typedef struct dl_rq {
+    rb_root_t root;                     /* Ready tasks, earliest deadline first */
+    hrtimer_t budget_timer;             /* Throttles curr when its budget runs out */
+    uint64_t nr_misses;                 /* Deadline misses seen on this CPU */
+    uint64_t nr_throttled;              /* Budget overruns */
+} dl_rq_t;
+
+/* Background (SCHED_IDLE) runqueue: round-robin list */
+typedef struct bg_rq {
+    list_head_t queue;                  /* Ready tasks, next to run first */
+} bg_rq_t;
+
+/* Class ranks, highest first (bit in queued_mask, index in nr_running_class) */
+enum {
+    SCHED_CLASS_DL,
+    SCHED_CLASS_RT,
+    SCHED_CLASS_FAIR,
+    SCHED_CLASS_BG,
+    SCHED_CLASS_IDLE,
+    SCHED_CLASS_COUNT
+};
+
+/*
+ * Per-CPU runqueue: one queue per class. The running task stays on_rq but
+ * is kept out of its class's queue. All fields are protected by lock,
+ * which is always taken with interrupts disabled.
+ */
+typedef struct runqueue {
+    spinlock_t lock;
+    uint32_t cpu;               /* CPU this runqueue belongs to */
+    task_struct_t* curr;        /* Task running on this CPU */
+    task_struct_t* idle;        /* This CPU's idle task */
+    task_struct_t* prev;        /* Task being switched out (see finish_task_switch) */
+    uint64_t clock;             /* Monotonic clock for CFS (ns, advanced per tick) */
+    uint32_t queued_mask;       /* Bit c set = class c has a ready task queued */
+    dl_rq_t dl;                 /* Ready SCHED_DEADLINE tasks */
+    rt_rq_t rt;                 /* Ready SCHED_FIFO/SCHED_RR tasks */
+    rb_root_t tasks_timeline;   /* Ready CFS tasks ordered by vruntime */
+    uint64_t min_vruntime;      /* Monotonic floor for placing new/woken tasks */
+    bg_rq_t bg;                 /* Ready SCHED_IDLE tasks */
+    uint64_t load_weight;       /* Sum of weights of all on_rq tasks */
+    uint32_t nr_running;        /* Number of on_rq tasks (queued + running) */
+    uint32_t nr_running_class[SCHED_CLASS_COUNT];   /* The same, per class */
+    task_struct_t* skip;        /* Task that just yielded (skip buddy) */
+    uint32_t balance_countdown; /* Ticks until the next periodic load balance */
+    volatile bool nohz_idle;    /* Idle with the tick stopped (see kernel/tick.h) */
+    sched_balance_stats_t stats;
+} runqueue_t;
+
+/* enqueue_task() flags */
+#define ENQUEUE_HEAD        0x01    /* Front of its queue (preempted mid-slice) */
+#define ENQUEUE_WAKEUP      0x02    /* Was not runnable in this class: place it */
+#define ENQUEUE_INITIAL     0x04    /* Brand new task (with ENQUEUE_WAKEUP) */
+
+/*
+ * Class operations; all run with rq->lock held. enqueue/dequeue only link
+ * and unlink ready tasks (the core keeps the counts); the running task is
+ * handed over with set_next_task() (after the core unlinked it and reset
+ * exec_start) and taken back with put_prev_task(), which relinks it.
+ */
+typedef struct sched_class {
+    const struct sched_class* next;     /* Next lower class */
+    uint32_t rank;                      /* SCHED_CLASS_* */
+
+    void (*init_rq)(runqueue_t* rq);
+    void (*enqueue_task)(runqueue_t* rq, task_struct_t* task, uint32_t flags);
+    void (*dequeue_task)(runqueue_t* rq, task_struct_t* task);
+    task_struct_t* (*pick_next_task)(runqueue_t* rq);   /* Peek, never NULL with bit set */
+    void (*set_next_task)(runqueue_t* rq, task_struct_t* task);    /* Optional */
+    void (*put_prev_task)(runqueue_t* rq, task_struct_t* task);
+    void (*task_tick)(runqueue_t* rq, task_struct_t* curr);
+    void (*update_curr)(runqueue_t* rq, task_struct_t* curr);
+
+    /* next and rq->curr both belong to this class */
+    bool (*check_preempt_curr)(runqueue_t* rq, task_struct_t* next);
+
+    /* CPU for a task becoming runnable (optional, pi_lock held, no rq lock) */
+    uint32_t (*select_task_rq)(task_struct_t* task);
+
+    /* Task leaves this class or exits it (optional) */
+    void (*switched_from)(runqueue_t* rq, task_struct_t* task);
+} sched_class_t;
+
+extern const sched_class_t dl_sched_class;
+extern const sched_class_t rt_sched_class;
+extern const sched_class_t fair_sched_class;
+extern const sched_class_t bg_sched_class;
+extern const sched_class_t idle_sched_class;
+
+#define sched_class_highest (&dl_sched_class)
+#define for_each_class(class) \
+    for (const sched_class_t* class = sched_class_highest; class; class = class->next)
+
+/* Core state shared with the classes */
+extern runqueue_t runqueues[MAX_CPUS];
+
+static inline runqueue_t* cpu_rq(uint32_t cpu) {
+    return &runqueues[cpu];
+}
+
+static inline runqueue_t* this_rq(void) {
+    return cpu_rq(smp_processor_id());
+}
+
+/* need_resched lives in the per-CPU area, where the IRQ exit path reads it */
+static inline void set_need_resched(runqueue_t* rq) {
+    cpu_locals[rq->cpu].need_resched = 1;
+}
+
+static inline void clear_need_resched(runqueue_t* rq) {
+    cpu_locals[rq->cpu].need_resched = 0;
+}
+
+static inline bool need_resched(runqueue_t* rq) {
+    return cpu_locals[rq->cpu].need_resched != 0;
+}
+
+/* Mark a class's queue (non-)empty in rq->queued_mask */
+static inline void rq_set_queued(runqueue_t* rq, const sched_class_t* class, bool queued) {
+    if (queued) {
+        rq->queued_mask |= 1u << class->rank;
+    } else {
+        rq->queued_mask &= ~(1u << class->rank);
+    }
+}
+
+static inline bool rt_task(task_struct_t* task) {
+    return task->sched_class == &rt_sched_class;
+}
+
+static inline bool dl_task(task_struct_t* task) {
+    return task->sched_class == &dl_sched_class;
+}
+
+static inline bool fair_task(task_struct_t* task) {
+    return task->sched_class == &fair_sched_class;
+}
+
+static inline task_struct_t* rb_task(rb_node_t* node) {
+    return node ? rb_entry(node, task_struct_t, run_node) : NULL;
+}
+
+/* Nothing but background work (or the idle task) queued: idle as far as
+ * load balancing goes */
+static inline bool rq_idle_queued(runqueue_t* rq) {
+    return (rq->queued_mask & ((1u << SCHED_CLASS_BG) - 1)) == 0;
+}
+
+/* True if task ran on rq so recently that its cache footprint is still there */
+static inline bool task_hot(runqueue_t* rq, task_struct_t* task) {
+    return rq->clock - task->last_ran < SCHED_MIGRATION_COST_NS;
+}
+
+/*
+ * Time slices, shared by SCHED_RR and the background class: both take
+ * turns in DEFAULT_TIMESLICE ticks within a FIFO list, and neither has a
+ * vruntime to update.
+ */
+
+/* Charge curr with the runtime since it last started or was charged */
+static inline void update_curr_common(runqueue_t* rq, task_struct_t* curr) {
+    uint64_t now = rq->clock;
+    curr->sum_exec_runtime += now - curr->exec_start;
+    curr->exec_start = now;
+}
+
+/* Tick of a sliced task: at the end of its slice, reschedule if others
+ * wait in its list, else just start a new slice */
+static inline void slice_tick(runqueue_t* rq, task_struct_t* curr, list_head_t* queue) {
+    if (curr->time_slice > 0) {
+        curr->time_slice--;
+    }
+    if (curr->time_slice > 0) {
+        return;
+    }
+
+    if (list_empty(queue)) {
+        curr->time_slice = DEFAULT_TIMESLICE;
+    } else {
+        /* slice_requeue_flags() sends it to the tail */
+        set_need_resched(rq);
+    }
+}
+
+/* enqueue_task() flags for a task leaving the CPU: a preempted task keeps
+ * its place at the head of its list; one that yielded or used up its
+ * slice (if sliced) goes to the tail, with a new slice */
+static inline uint32_t slice_requeue_flags(runqueue_t* rq, task_struct_t* task, bool sliced) {
+    bool expired = sliced && task->time_slice == 0;
+
+    if (expired) {
+        task->time_slice = DEFAULT_TIMESLICE;
+    }
+    return (rq->skip != task && !expired) ? ENQUEUE_HEAD : 0;
+}
+
+/* Core (sched.c) */
+void resched_curr(runqueue_t* rq);
+bool check_preempt_curr(runqueue_t* rq, task_struct_t* next);
+runqueue_t* task_rq_lock(task_struct_t* task);
+
+/* Fair class (sched_fair.c) */
+uint32_t priority_to_weight(uint8_t priority);
+uint32_t load_balance(runqueue_t* this_rq, bool idle);
+void nohz_balance_kick(runqueue_t* rq);
+
+/* Deadline class (sched_dl.c) */
+typedef struct sched_dl_attr {
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+} sched_dl_attr_t;
+
+void init_dl_task(task_struct_t* task);
+int dl_bw_reserve(task_struct_t* task, uint64_t new_bw);
+void dl_bw_release(task_struct_t* task);
+void dl_set_params(task_struct_t* task, const sched_dl_attr_t* attr);
+
+#endif /* KERNEL_SCHED_CLASS_H */
@@ -0,0 +1,21 @@
+/**
+ * Vectorized Kernels
+ *
+ * Built from KERNEL_SIMD_SOURCES, the only files compiled with FP/SIMD
+ * code generation. Callers must be inside a kernel_fpu_begin() /
+ * kernel_fpu_end() section (kernel/fpu.h); outside one the first vector
+ * instruction traps.
+ */
+
+#ifndef KERNEL_SIMD_H
+#define KERNEL_SIMD_H
+
+#include <kernel/types.h>
+
+/**
+ * Sum of the buffer's little-endian 32-bit words, modulo 2^32 (a final
+ * partial word is zero-padded)
+ */
+uint32_t simd_csum32(const void* buf, size_t len);
+
+#endif /* KERNEL_SIMD_H */
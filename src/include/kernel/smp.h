@@ -0,0 +1,102 @@
+/**
+ * Symmetric Multiprocessing - CPU identification and per-CPU data
+ */
+
+#ifndef KERNEL_SMP_H
+#define KERNEL_SMP_H
+
+#include <kernel/types.h>
+
+/* Maximum number of CPUs supported (GICv2 limit on ARM64) */
+#define MAX_CPUS 8
+
+/* Per-CPU stack the IRQ handlers run on (IRQs do not nest) */
+#define IRQ_STACK_SIZE 16384
+
+/* Per-CPU data area (one per CPU, found through a CPU register) */
+typedef struct cpu_local {
+    struct cpu_local* self;     /* Must be first: lets x86_64 read it via %gs:0 */
+    uint32_t cpu_id;            /* Logical CPU number (0 = boot CPU) */
+    uint64_t hw_id;             /* Hardware ID (ARM64: MPIDR affinity, x86_64: APIC ID) */
+    volatile bool online;       /* Set by the CPU itself once it can schedule */
+    uint32_t preempt_count;     /* Preemption disabled while nonzero (kernel/preempt.h) */
+    volatile uint32_t need_resched; /* Current task should be switched out */
+    uint64_t irq_stack_top;     /* Initial SP of this CPU's IRQ stack */
+} __attribute__((aligned(64))) cpu_local_t;    /* One cache line per CPU */
+
+/* The IRQ entry/exit paths (x86_64 interrupts.S, ARM64 boot.S) hard-code these */
+#define CPU_LOCAL_PREEMPT_COUNT     28
+#define CPU_LOCAL_NEED_RESCHED      32
+#define CPU_LOCAL_IRQ_STACK         40
+
+_Static_assert(__builtin_offsetof(cpu_local_t, preempt_count) == CPU_LOCAL_PREEMPT_COUNT,
+               "CPU_LOCAL_PREEMPT_COUNT is out of date");
+_Static_assert(__builtin_offsetof(cpu_local_t, need_resched) == CPU_LOCAL_NEED_RESCHED,
+               "CPU_LOCAL_NEED_RESCHED is out of date");
+_Static_assert(__builtin_offsetof(cpu_local_t, irq_stack_top) == CPU_LOCAL_IRQ_STACK,
+               "CPU_LOCAL_IRQ_STACK is out of date");
+
+extern cpu_local_t cpu_locals[MAX_CPUS];
+
+/* Get this CPU's per-CPU area */
+static inline cpu_local_t* this_cpu(void) {
+#if defined(__aarch64__)
+    cpu_local_t* cpu;
+    __asm__ volatile("mrs %0, tpidr_el1" : "=r"(cpu));
+    return cpu;
+#else
+    /* GS base points at the area, whose first field points at itself */
+    cpu_local_t* cpu;
+    __asm__ volatile("movq %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+#endif
+}
+
+/* Get the logical number of the calling CPU */
+static inline uint32_t smp_processor_id(void) {
+    return this_cpu()->cpu_id;
+}
+
+/**
+ * Mark the calling CPU online (visible to the scheduler)
+ */
+void smp_mark_online(void);
+
+/**
+ * Get number of online CPUs
+ */
+uint32_t smp_num_cpus(void);
+
+/**
+ * Check whether a CPU is online
+ */
+bool smp_cpu_online(uint32_t cpu);
+
+/**
+ * Get the initial stack pointer of a CPU's IRQ stack
+ * @param cpu - Logical CPU number
+ */
+uint64_t smp_irq_stack_top(uint32_t cpu);
+
+/* Architecture-specific */
+
+/**
+ * Set up the per-CPU area of the calling CPU (including its IRQ stack)
+ * and make this_cpu() work; must run before the CPU enables IRQs
+ * @param cpu - Logical CPU number
+ * @param hw_id - Architecture hardware ID
+ */
+void smp_setup_cpu(uint32_t cpu, uint64_t hw_id);
+
+/**
+ * Boot all secondary CPUs (called once by the boot CPU)
+ */
+void smp_init(void);
+
+/**
+ * Ask another CPU to run schedule() (reschedule IPI)
+ * @param cpu - Target logical CPU
+ */
+void smp_send_reschedule(uint32_t cpu);
+
+#endif /* KERNEL_SMP_H */
@@ -0,0 +1,185 @@
+/**
+ * Spinlocks - busy-wait mutual exclusion between CPUs
+ *
+ * Ticket locks: a CPU takes the next ticket with one atomic add (LDADDA
+ * with LSE, see kernel/atomic.h) and waits until the owner field reaches
+ * it, so waiters get the lock in arrival order and each acquisition costs
+ * one atomic on the lock word however many CPUs wait. Waiting is
+ * read-only (WFE on ARM64, PAUSE on x86_64), so the line is only written
+ * at acquire and release.
+ *
+ * On ARM64 locks do nothing until the boot CPU's MMU is on
+ * (arm64_mmu_enabled): atomics need Normal memory, and no other CPU runs
+ * yet.
+ *
+ * spin_lock() does not mask interrupts: a lock that is also taken from an
+ * IRQ handler must be acquired with spin_lock_irqsave() (or with
+ * interrupts_save() held around it).
+ *
+ * Built with SPINLOCK_STATS, every lock also counts its acquisitions,
+ * the contended ones and the cycles spent waiting; see
+ * spin_lock_stats_report().
+ */
+
+#ifndef KERNEL_SPINLOCK_H
+#define KERNEL_SPINLOCK_H
+
+#include <kernel/types.h>
+#include <kernel/atomic.h>
+#include <arch/cycles.h>
+#include <arch/interrupts.h>
+
+#ifdef SPINLOCK_STATS
+typedef struct spinlock_stats {
+    uint64_t acquisitions;
+    uint64_t contended;         /* Acquisitions that had to wait */
+    uint64_t spin_cycles;       /* arch_cycles() spent waiting */
+} spinlock_stats_t;
+#endif
+
+/* Little-endian: owner is the low half of val, next the high half */
+typedef struct spinlock {
+    union {
+        volatile uint32_t val;
+        struct {
+            volatile uint16_t owner;    /* Ticket being served */
+            volatile uint16_t next;     /* Next ticket to hand out */
+        };
+    };
+#ifdef SPINLOCK_STATS
+    spinlock_stats_t stats;     /* Updated by the holder */
+#endif
+} spinlock_t;
+
+#define SPINLOCK_TICKET_SHIFT   16
+
+#define SPINLOCK_INIT { .val = 0 }
+
+static inline void spin_lock_init(spinlock_t* lock) {
+    lock->val = 0;
+#ifdef SPINLOCK_STATS
+    lock->stats = (spinlock_stats_t){ 0, 0, 0 };
+#endif
+}
+
+/* Early ARM64 boot: skip locking (see above) */
+static inline bool spin_lock_skipped(void) {
+#if defined(__aarch64__)
+    return __builtin_expect(!arm64_mmu_enabled, 0);
+#else
+    return false;
+#endif
+}
+
+/* Take a ticket; returns the lock word before the increment (acquire) */
+static inline uint32_t arch_spin_take_ticket(spinlock_t* lock) {
+    return arch_atomic32_fetch_add_acquire(&lock->val, 1U << SPINLOCK_TICKET_SHIFT);
+}
+
+/* Wait until ticket is being served (acquire) */
+static inline void arch_spin_wait_owner(spinlock_t* lock, uint16_t ticket) {
+#if defined(__aarch64__)
+    /* The exclusive load arms the monitor: the unlocking store to owner
+     * wakes us from WFE */
+    uint32_t owner;
+    __asm__ volatile(
+        "   sevl\n"
+        "1: wfe\n"
+        "   ldaxrh  %w0, [%1]\n"
+        "   cmp     %w0, %w2\n"
+        "   b.ne    1b\n"
+        : "=&r"(owner)
+        : "r"(&lock->owner), "r"((uint32_t)ticket)
+        : "cc", "memory");
+#else
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        __asm__ volatile("pause");
+    }
+#endif
+}
+
+/* Acquire lock (acquire ordering) */
+static inline void spin_lock(spinlock_t* lock) {
+    if (spin_lock_skipped()) {
+        return;
+    }
+
+    uint32_t old = arch_spin_take_ticket(lock);
+    uint16_t ticket = (uint16_t)(old >> SPINLOCK_TICKET_SHIFT);
+
+    if ((uint16_t)old != ticket) {
+#ifdef SPINLOCK_STATS
+        uint64_t start = arch_cycles();
+        arch_spin_wait_owner(lock, ticket);
+        lock->stats.spin_cycles += arch_cycles() - start;
+        lock->stats.contended++;
+#else
+        arch_spin_wait_owner(lock, ticket);
+#endif
+    }
+#ifdef SPINLOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+}
+
+/* Acquire lock if it is free; returns true if it was taken */
+static inline bool spin_trylock(spinlock_t* lock) {
+    if (spin_lock_skipped()) {
+        return true;
+    }
+
+    uint32_t old = lock->val;
+
+    if ((uint16_t)old != (uint16_t)(old >> SPINLOCK_TICKET_SHIFT)) {
+        return false;
+    }
+    if (arch_atomic32_cmpxchg(&lock->val, old, old + (1U << SPINLOCK_TICKET_SHIFT)) != old) {
+        return false;
+    }
+#ifdef SPINLOCK_STATS
+    lock->stats.acquisitions++;
+#endif
+    return true;
+}
+
+/* Release lock (release ordering): serve the next ticket. Only the holder
+ * writes owner, so a plain read of it is enough. */
+static inline void spin_unlock(spinlock_t* lock) {
+    if (spin_lock_skipped()) {
+        return;
+    }
+
+    uint16_t next = (uint16_t)(lock->owner + 1);
+#if defined(__aarch64__)
+    __asm__ volatile("stlrh %w1, [%0]" :: "r"(&lock->owner), "r"((uint32_t)next) : "memory");
+#else
+    __atomic_store_n(&lock->owner, next, __ATOMIC_RELEASE);
+#endif
+}
+
+/* True if some CPU holds the lock */
+static inline bool spin_is_locked(spinlock_t* lock) {
+    uint32_t val = lock->val;
+    return (uint16_t)val != (uint16_t)(val >> SPINLOCK_TICKET_SHIFT);
+}
+
+/* Disable interrupts and acquire; returns the state for spin_unlock_irqrestore() */
+static inline uint64_t spin_lock_irqsave(spinlock_t* lock) {
+    uint64_t flags = interrupts_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint64_t flags) {
+    spin_unlock(lock);
+    interrupts_restore(flags);
+}
+
+/**
+ * Print a LOCK_STATS line for a lock (SPINLOCK_STATS builds; no-op otherwise)
+ * @param name - Lock name
+ * @param instance - Which of several same-named locks (e.g. the CPU)
+ */
+void spin_lock_stats_report(const char* name, uint32_t instance, spinlock_t* lock);
+
+#endif /* KERNEL_SPINLOCK_H */
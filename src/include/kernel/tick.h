@@ -0,0 +1,75 @@
+/**
+ * Scheduler Tick - periodic hrtimer with dynamic tick (NO_HZ idle)
+ *
+ * Each CPU's scheduler tick is an hrtimer firing every SCHED_TICK_NS.
+ * While a CPU has nothing to run, the tick is pushed out to the next
+ * event that needs it, so the timer hardware is programmed only for the
+ * earliest real expiry. The skipped ticks are accounted in one go when
+ * the CPU wakes up.
+ */
+
+#ifndef KERNEL_TICK_H
+#define KERNEL_TICK_H
+
+#include <kernel/types.h>
+#include <kernel/sched.h>
+
+/* Longest tickless sleep; also bounds how stale idle-time statistics get */
+#define NOHZ_MAX_IDLE_NS    1000000000ULL   /* 1 s */
+
+/* Shorter idle periods keep the tick (reprogramming would cost more) */
+#define NOHZ_MIN_IDLE_NS    (2 * SCHED_TICK_NS)
+
+/* Per-CPU dynamic tick counters */
+typedef struct tick_stats {
+    uint64_t idle_entries;      /* Times the idle loop went to sleep */
+    uint64_t tick_stops;        /* Sleeps with the periodic tick stopped */
+    uint64_t ticks_skipped;     /* Ticks accounted on wakeup instead of taken */
+} tick_stats_t;
+
+/**
+ * Start the calling CPU's tick (called by the timer driver once the
+ * CPU's timer hardware works)
+ */
+void tick_init_cpu(void);
+
+/**
+ * Idle loop: about to sleep (IRQs disabled); stops the tick if possible
+ */
+void tick_nohz_idle_enter(void);
+
+/**
+ * Idle loop: woken up (IRQs disabled); restarts the tick and catches up
+ */
+void tick_nohz_idle_exit(void);
+
+/**
+ * IRQ entry: restart the tick if the interrupt hit a tickless idle CPU
+ */
+void tick_nohz_irq_enter(void);
+
+/**
+ * True if the calling CPU's periodic tick is currently stopped
+ */
+bool tick_nohz_tick_stopped(void);
+
+/**
+ * Enable or disable the dynamic tick (enabled by default)
+ */
+void tick_nohz_set_enabled(bool enabled);
+
+/**
+ * Dynamic tick statistics
+ */
+void tick_get_stats(uint32_t cpu, tick_stats_t* stats);
+void tick_print_stats(void);
+
+/* Architecture timer driver */
+
+/**
+ * Advance the global tick count (boot CPU; >1 after a tickless period)
+ * @param ticks - Ticks elapsed
+ */
+void timer_account_ticks(uint64_t ticks);
+
+#endif /* KERNEL_TICK_H */
@@ -0,0 +1,94 @@
+/**
+ * Timer Wheel - cheap coarse timeouts
+ *
+ * Tick-granularity timers for timeouts that are usually cancelled before
+ * they fire (idle connections, I/O watchdogs). Arming and cancelling are
+ * O(1) list operations; the wheel advances from scheduler_tick(). Use
+ * hrtimers (kernel/hrtimer.h) when the expiry has to be precise.
+ */
+
+#ifndef KERNEL_TIMER_WHEEL_H
+#define KERNEL_TIMER_WHEEL_H
+
+#include <kernel/types.h>
+#include <kernel/list.h>
+#include <kernel/sched.h>
+
+struct timer_list;
+struct timer_wheel;
+
+/* Runs from the tick (IRQ context, IRQs disabled) on the timer's CPU */
+typedef void (*timer_fn_t)(struct timer_list* timer);
+
+typedef struct timer_list {
+    list_head_t entry;              /* Node in a wheel slot */
+    uint64_t expires;               /* Absolute expiry (jiffies) */
+    timer_fn_t function;
+    void* data;                     /* Owner's context for the callback */
+    struct timer_wheel* base;       /* Wheel it belongs to (NULL: never armed) */
+} timer_list_t;
+
+/* Time in ticks since boot (shared by all CPUs) */
+uint64_t jiffies_get(void);
+
+static inline uint64_t msecs_to_jiffies(uint64_t ms) {
+    return (ms * 1000000ULL + SCHED_TICK_NS - 1) / SCHED_TICK_NS;
+}
+
+/**
+ * Initialize a timer (not armed)
+ * @param timer - Timer
+ * @param function - Callback
+ * @param data - Stored in timer->data for the callback
+ */
+void timer_setup(timer_list_t* timer, timer_fn_t function, void* data);
+
+/**
+ * Arm or re-arm a timer on the calling CPU - O(1)
+ * @param timer - Timer
+ * @param expires - Absolute expiry in jiffies
+ * @return true if the timer was pending before
+ */
+bool mod_timer(timer_list_t* timer, uint64_t expires);
+
+/**
+ * Arm a timer ticks from now - O(1)
+ */
+static inline bool timer_arm(timer_list_t* timer, uint64_t ticks) {
+    return mod_timer(timer, jiffies_get() + ticks);
+}
+
+/**
+ * Cancel a timer - O(1); the callback may still be running elsewhere
+ * @return true if the timer was pending
+ */
+bool del_timer(timer_list_t* timer);
+
+/**
+ * Cancel a timer and wait for a running callback to finish
+ * Must not be called from the timer's own callback.
+ * @return true if the timer was pending
+ */
+bool del_timer_sync(timer_list_t* timer);
+
+/**
+ * Check whether a timer is armed
+ */
+static inline bool timer_pending(const timer_list_t* timer) {
+    return !list_empty(&timer->entry);
+}
+
+/**
+ * Advance the calling CPU's wheel to now and run expired timers
+ * (called from scheduler_tick(), IRQs disabled)
+ */
+void timer_wheel_run(void);
+
+/**
+ * Earliest jiffy at which the calling CPU's wheel needs the tick
+ * (NO_HZ idle); may be earlier than the first expiry, never later
+ * @return Absolute jiffies, or HRTIMER_NO_EXPIRY if the wheel is empty
+ */
+uint64_t timer_wheel_next_expiry(void);
+
+#endif /* KERNEL_TIMER_WHEEL_H */
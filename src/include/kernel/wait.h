@@ -0,0 +1,92 @@
+/**
+ * Wait Queues - block until a condition becomes true
+ *
+ * A waiter queues itself, sets its state to TASK_BLOCKED and only then
+ * checks the condition, so a wake_up() between the check and schedule()
+ * just makes it runnable again instead of getting lost:
+ *
+ *     wait_event(dev->wq, dev->data_ready);       (waiter)
+ *
+ *     dev->data_ready = true;                     (waker, any context)
+ *     wake_up(&dev->wq);
+ */
+
+#ifndef KERNEL_WAIT_H
+#define KERNEL_WAIT_H
+
+#include <kernel/types.h>
+#include <kernel/list.h>
+#include <kernel/spinlock.h>
+#include <kernel/sched.h>
+#include <kernel/hrtimer.h>
+
+typedef struct wait_queue_head {
+    spinlock_t lock;            /* Taken with IRQs disabled */
+    list_head_t head;           /* Waiters, oldest first */
+} wait_queue_head_t;
+
+typedef struct wait_queue_entry {
+    list_head_t entry;          /* Node in the queue (empty once woken) */
+    task_struct_t* task;
+} wait_queue_entry_t;
+
+#define WAIT_QUEUE_HEAD_INIT(name) { SPINLOCK_INIT, LIST_HEAD_INIT((name).head) }
+
+void init_waitqueue_head(wait_queue_head_t* wq);
+
+/* Set up a wait entry for the current task */
+void init_wait_entry(wait_queue_entry_t* wait);
+
+/**
+ * Queue the current task (if not queued yet) and set its state
+ * @param state - TASK_BLOCKED (or TASK_SLEEPING)
+ */
+void prepare_to_wait(wait_queue_head_t* wq, wait_queue_entry_t* wait, task_state_t state);
+
+/* Leave the queue and become TASK_RUNNING again */
+void finish_wait(wait_queue_head_t* wq, wait_queue_entry_t* wait);
+
+/**
+ * Wake all waiters / the oldest waiter (callable from IRQ context)
+ * @return Number of tasks woken
+ */
+uint32_t wake_up(wait_queue_head_t* wq);
+uint32_t wake_up_one(wait_queue_head_t* wq);
+
+/* Block until cond is true (task context only) */
+#define wait_event(wq, cond) do {                                       \
+        wait_queue_entry_t __wait;                                      \
+        init_wait_entry(&__wait);                                       \
+        for (;;) {                                                      \
+            prepare_to_wait(&(wq), &__wait, TASK_BLOCKED);              \
+            if (cond) {                                                 \
+                break;                                                  \
+            }                                                           \
+            schedule();                                                 \
+        }                                                               \
+        finish_wait(&(wq), &__wait);                                    \
+    } while (0)
+
+/* Block until cond is true or timeout_ns elapsed
+ * Evaluates to true if cond became true */
+#define wait_event_timeout(wq, cond, timeout_ns) ({                     \
+        uint64_t __deadline = timer_get_ns() + (timeout_ns);            \
+        bool __done;                                                    \
+        wait_queue_entry_t __wait;                                      \
+        init_wait_entry(&__wait);                                       \
+        for (;;) {                                                      \
+            prepare_to_wait(&(wq), &__wait, TASK_BLOCKED);              \
+            if ((__done = (cond))) {                                    \
+                break;                                                  \
+            }                                                           \
+            uint64_t __now = timer_get_ns();                            \
+            if (__now >= __deadline) {                                  \
+                break;                                                  \
+            }                                                           \
+            schedule_timeout(__deadline - __now);                       \
+        }                                                               \
+        finish_wait(&(wq), &__wait);                                    \
+        __done;                                                         \
+    })
+
+#endif /* KERNEL_WAIT_H */
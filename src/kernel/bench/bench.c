@@ -0,0 +1,211 @@
+/**
+ * In-kernel Benchmarks - histograms, reporting and the suite runner
+ */
+
+#include <kernel/bench.h>
+#include <kernel/atomic.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/mm.h>
+#include <kernel/smp.h>
+#include <kernel/string.h>
+#include <kernel/tick.h>
+#include <kernel/wait.h>
+
+#define BENCH_STACK_SIZE    8192
+#define BENCH_CALIBRATE_NS  (20 * NSEC_PER_MSEC)
+
+#if defined(__aarch64__)
+#define BENCH_ARCH "arm64"
+#else
+#define BENCH_ARCH "x86_64"
+#endif
+
+/******************************************************************************
+ * Histograms
+ *****************************************************************************/
+
+int bench_hist_init(bench_hist_t* hist, const char* name) {
+    memset(hist, 0, sizeof(*hist));
+    hist->name = name;
+    hist->unit = "cycles";
+    hist->min = ~0ULL;
+    hist->samples = kmalloc(BENCH_MAX_SAMPLES * sizeof(uint64_t));
+    return hist->samples ? 0 : -1;
+}
+
+void bench_hist_add(bench_hist_t* hist, uint64_t cycles) {
+    if (hist->samples && hist->nr_samples < BENCH_MAX_SAMPLES) {
+        hist->samples[hist->nr_samples++] = cycles;
+    }
+    hist->count++;
+    hist->sum += cycles;
+    if (cycles < hist->min) {
+        hist->min = cycles;
+    }
+    if (cycles > hist->max) {
+        hist->max = cycles;
+    }
+    hist->buckets[cycles ? 64 - __builtin_clzll(cycles) - (cycles >> 63) : 0]++;
+}
+
+/* Sift-down step of heapsort */
+static void sift_down(uint64_t* a, uint32_t root, uint32_t n) {
+    for (;;) {
+        uint32_t child = 2 * root + 1;
+        if (child >= n) {
+            return;
+        }
+        if (child + 1 < n && a[child + 1] > a[child]) {
+            child++;
+        }
+        if (a[root] >= a[child]) {
+            return;
+        }
+        uint64_t tmp = a[root];
+        a[root] = a[child];
+        a[child] = tmp;
+        root = child;
+    }
+}
+
+/* In-place heapsort: no recursion, no extra memory */
+static void sort_samples(uint64_t* a, uint32_t n) {
+    for (uint32_t i = n / 2; i-- > 0;) {
+        sift_down(a, i, n);
+    }
+    for (uint32_t end = n; end-- > 1;) {
+        uint64_t tmp = a[0];
+        a[0] = a[end];
+        a[end] = tmp;
+        sift_down(a, 0, end);
+    }
+}
+
+/* Nearest-rank percentile of sorted samples */
+static uint64_t percentile(const uint64_t* sorted, uint32_t n, uint32_t pct) {
+    uint32_t rank = (n * pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+void bench_hist_report(bench_hist_t* hist) {
+    if (hist->count == 0 || !hist->samples) {
+        console_printf("BENCH name=%s unit=%s samples=0\n", hist->name, hist->unit);
+    } else {
+        sort_samples(hist->samples, hist->nr_samples);
+        console_printf("BENCH name=%s unit=%s samples=%llu min=%llu p50=%llu "
+                       "p99=%llu max=%llu mean=%llu\n",
+                       hist->name, hist->unit, hist->count, hist->min,
+                       percentile(hist->samples, hist->nr_samples, 50),
+                       percentile(hist->samples, hist->nr_samples, 99),
+                       hist->max, hist->sum / hist->count);
+
+        for (uint32_t b = 0; b < BENCH_HIST_BUCKETS; b++) {
+            if (hist->buckets[b]) {
+                /* Upper bound of bucket b: samples < 2^b */
+                console_printf("BENCH_HIST name=%s lt=%llu count=%llu\n",
+                               hist->name, b < 63 ? 1ULL << b : ~0ULL, hist->buckets[b]);
+            }
+        }
+    }
+
+    kfree(hist->samples);
+    hist->samples = NULL;
+}
+
+void bench_report_metric(const char* name, const char* metric, uint64_t value) {
+    console_printf("BENCH_METRIC name=%s metric=%s value=%llu\n", name, metric, value);
+}
+
+/* Count counter ticks across BENCH_CALIBRATE_NS of timer_get_ns() */
+uint64_t bench_counter_hz(void) {
+    static uint64_t hz;
+
+    if (hz == 0) {
+        uint64_t ns0 = timer_get_ns();
+        uint64_t c0 = bench_cycles();
+        uint64_t ns1;
+        do {
+            ns1 = timer_get_ns();
+        } while (ns1 - ns0 < BENCH_CALIBRATE_NS);
+        uint64_t c1 = bench_cycles();
+
+        hz = (c1 - c0) * NSEC_PER_SEC / (ns1 - ns0);
+    }
+    return hz;
+}
+
+/******************************************************************************
+ * Benchmark Tasks
+ *****************************************************************************/
+
+static wait_queue_head_t bench_sync_wq;
+static atomic_t bench_sync_remaining;
+
+void bench_sync_init(uint32_t tasks) {
+    init_waitqueue_head(&bench_sync_wq);
+    atomic_set(&bench_sync_remaining, (int32_t)tasks);
+}
+
+void bench_sync_done(void) {
+    if (atomic_dec_and_test(&bench_sync_remaining)) {
+        wake_up(&bench_sync_wq);
+    }
+}
+
+void bench_sync_wait(void) {
+    wait_event(bench_sync_wq, atomic_read_acquire(&bench_sync_remaining) == 0);
+}
+
+uint32_t bench_cpu(uint32_t n) {
+    n %= smp_num_cpus();
+    for (uint32_t cpu = MAX_CPUS; cpu-- > 0;) {
+        if (smp_cpu_online(cpu) && n-- == 0) {
+            return cpu;
+        }
+    }
+    return 0;
+}
+
+task_struct_t* bench_spawn(const char* name, void (*entry)(void),
+                           uint8_t rt_priority, uint32_t cpu) {
+    task_struct_t* task = task_create(name, entry, 5, BENCH_STACK_SIZE);
+    if (!task) {
+        return NULL;
+    }
+    if (rt_priority > 0) {
+        sched_setscheduler(task, SCHED_FIFO, rt_priority);
+    }
+    if (cpu < MAX_CPUS) {
+        task_bind_cpu(task, cpu);
+    }
+    task_ready(task);
+    return task;
+}
+
+/* Runner: each suite runs to completion before the next starts */
+static void bench_main(void) {
+    console_printf("BENCH_BEGIN arch=%s cpus=%u counter_hz=%llu\n",
+                   BENCH_ARCH, smp_num_cpus(), bench_counter_hz());
+
+    sched_bench_run();
+    latency_bench_run();
+    hackbench_run();
+    fpu_bench_run();
+
+#ifdef SPINLOCK_STATS
+    sched_print_lock_stats();
+#endif
+    tick_print_stats();
+    stack_usage_report();
+
+    console_printf("BENCH_END\n");
+}
+
+void bench_start(void) {
+    task_struct_t* task = task_create("bench", bench_main, 5, BENCH_STACK_SIZE);
+    if (task) {
+        task_ready(task);
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * FP/SIMD Section Benchmark
+ *
+ * fpu_preempt: two fair tasks per CPU, bound together, each checksum
+ * their own buffer with simd_csum32() inside kernel_fpu_begin() /
+ * kernel_fpu_end() sections long enough for the tick to preempt them
+ * mid-loop, and yield inside the section as well. Every result is
+ * checked against a scalar checksum computed up front, so a register
+ * set lost or mixed up at a context switch shows up as errors:
+ *
+ *     BENCH_METRIC name=fpu_preempt metric=errors value=0
+ *     BENCH_METRIC name=fpu_preempt metric=mb_per_sec value=..
+ */
+
+#include <kernel/bench.h>
+#include <kernel/atomic.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/fpu.h>
+#include <kernel/hrtimer.h>
+#include <kernel/mm.h>
+#include <kernel/simd.h>
+#include <kernel/smp.h>
+
+#ifndef FPU_BENCH_ROUNDS
+#define FPU_BENCH_ROUNDS        200     /* Sections per task */
+#endif
+
+#define FPU_BENCH_BUF_SIZE      (64 * 1024)
+#define FPU_BENCH_PASSES        8       /* Checksums per section */
+#define FPU_BENCH_TASKS_PER_CPU 2
+
+static struct {
+    uint8_t* bufs[MAX_CPUS * FPU_BENCH_TASKS_PER_CPU];
+    uint32_t expected[MAX_CPUS * FPU_BENCH_TASKS_PER_CPU];
+    uint32_t next_id;
+    atomic_t errors;
+} fb;
+
+/* Reference checksum, in general-purpose registers */
+static uint32_t csum32_scalar(const uint8_t* p, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += (uint32_t)p[i] << (8 * (i % 4));
+    }
+    return sum;
+}
+
+static void fpu_worker(void) {
+    uint32_t id = __atomic_fetch_add(&fb.next_id, 1, __ATOMIC_RELAXED);
+    const uint8_t* buf = fb.bufs[id];
+    uint32_t expected = fb.expected[id];
+
+    for (uint32_t r = 0; r < FPU_BENCH_ROUNDS; r++) {
+        kernel_fpu_begin();
+        for (uint32_t pass = 0; pass < FPU_BENCH_PASSES; pass++) {
+            if (simd_csum32(buf, FPU_BENCH_BUF_SIZE) != expected) {
+                atomic_inc(&fb.errors);
+            }
+            if (pass == FPU_BENCH_PASSES / 2) {
+                task_yield();   /* Switch to the peer mid-section */
+            }
+        }
+        kernel_fpu_end();
+    }
+    bench_sync_done();
+}
+
+void fpu_bench_run(void) {
+    uint32_t cpus = smp_num_cpus();
+    uint32_t nr_tasks = cpus * FPU_BENCH_TASKS_PER_CPU;
+
+    fb.next_id = 0;
+    atomic_set(&fb.errors, 0);
+
+    /* Distinct contents per task: a restore of the wrong task's partial
+     * sums gives a wrong checksum */
+    for (uint32_t i = 0; i < nr_tasks; i++) {
+        fb.bufs[i] = kmalloc(FPU_BENCH_BUF_SIZE);
+        if (!fb.bufs[i]) {
+            console_printf("BENCH name=fpu_preempt error=nomem\n");
+            while (i-- > 0) {
+                kfree(fb.bufs[i]);
+            }
+            return;
+        }
+        for (uint32_t j = 0; j < FPU_BENCH_BUF_SIZE; j++) {
+            fb.bufs[i][j] = (uint8_t)(j * 131 + i * 29 + 7);
+        }
+        fb.expected[i] = csum32_scalar(fb.bufs[i], FPU_BENCH_BUF_SIZE);
+    }
+
+    bench_sync_init(nr_tasks);
+    uint64_t start = timer_get_ns();
+    for (uint32_t i = 0; i < nr_tasks; i++) {
+        if (!bench_spawn("fpu_csum", fpu_worker, 0, bench_cpu(i / FPU_BENCH_TASKS_PER_CPU))) {
+            console_printf("BENCH name=fpu_preempt error=spawn\n");
+            bench_sync_done();
+        }
+    }
+    bench_sync_wait();
+    uint64_t elapsed = timer_get_ns() - start;
+
+    for (uint32_t i = 0; i < nr_tasks; i++) {
+        kfree(fb.bufs[i]);
+    }
+
+    bench_report_metric("fpu_preempt", "errors", (uint64_t)atomic_read(&fb.errors));
+    if (elapsed > 0) {
+        uint64_t bytes = (uint64_t)nr_tasks * FPU_BENCH_ROUNDS * FPU_BENCH_PASSES *
+                         FPU_BENCH_BUF_SIZE;
+        bench_report_metric("fpu_preempt", "mb_per_sec",
+                            bytes * NSEC_PER_SEC / elapsed / (1024 * 1024));
+    }
+}
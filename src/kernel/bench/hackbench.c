@@ -0,0 +1,160 @@
+/**
+ * Messaging Throughput Benchmark (hackbench style)
+ *
+ * Tasks form groups of senders and receivers. Each receiver owns a
+ * channel, and every sender in a group sends HACKBENCH_LOOPS messages to
+ * each receiver of its group, so every message is a potential wakeup and
+ * senders fan out to all their receivers. Tasks are fair-class and not
+ * bound, so wakeup placement and load balancing are part of what is
+ * measured. The sweep doubles the task count from 2 to
+ * HACKBENCH_MAX_TASKS and reports, per count:
+ *
+ *     BENCH_METRIC name=hackbench_64 metric=msgs_per_sec value=..
+ *     BENCH_METRIC name=hackbench_64 metric=switches_per_sec value=..
+ */
+
+#include <kernel/bench.h>
+#include <kernel/atomic.h>
+#include <kernel/channel.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/smp.h>
+#include <kernel/string.h>
+#include <kernel/wait.h>
+
+#ifndef HACKBENCH_LOOPS
+#define HACKBENCH_LOOPS         50      /* Messages per sender per receiver */
+#endif
+#ifndef HACKBENCH_MAX_TASKS
+#define HACKBENCH_MAX_TASKS     256
+#endif
+
+#define HACKBENCH_GROUP_SENDERS 4       /* Per group, unless the count is smaller */
+#define HACKBENCH_MSG_SIZE      64
+#define HACKBENCH_DEPTH         16      /* Channel capacity in messages */
+
+static struct {
+    channel_t* channels[HACKBENCH_MAX_TASKS / 2];   /* One per receiver */
+    uint32_t senders;               /* Senders (= receivers) per group */
+    uint32_t next_sender;
+    uint32_t next_receiver;
+    wait_queue_head_t start_wq;     /* Workers wait here for go */
+    volatile bool go;
+    atomic64_t switches;            /* Context switches of exited workers */
+} hb;
+
+static void hackbench_wait_start(void) {
+    wait_event(hb.start_wq, hb.go);
+}
+
+static void hackbench_done(void) {
+    atomic64_fetch_add(&hb.switches, (int64_t)get_current_task()->switches);
+    bench_sync_done();
+}
+
+static void hackbench_sender(void) {
+    uint32_t id = __atomic_fetch_add(&hb.next_sender, 1, __ATOMIC_RELAXED);
+    channel_t** group = &hb.channels[id / hb.senders * hb.senders];
+    uint8_t msg[HACKBENCH_MSG_SIZE];
+
+    memset(msg, (int)id, sizeof(msg));
+    hackbench_wait_start();
+
+    for (uint32_t i = 0; i < HACKBENCH_LOOPS; i++) {
+        for (uint32_t r = 0; r < hb.senders; r++) {
+            channel_send(group[r], msg);
+        }
+    }
+    hackbench_done();
+}
+
+static void hackbench_receiver(void) {
+    uint32_t id = __atomic_fetch_add(&hb.next_receiver, 1, __ATOMIC_RELAXED);
+    channel_t* ch = hb.channels[id];
+    uint8_t msg[HACKBENCH_MSG_SIZE];
+
+    hackbench_wait_start();
+
+    for (uint32_t i = 0; i < hb.senders * HACKBENCH_LOOPS; i++) {
+        channel_recv(ch, msg);
+    }
+    hackbench_done();
+}
+
+/* nr_tasks workers, half senders and half receivers */
+static void run_hackbench(const char* name, uint32_t nr_tasks) {
+    uint32_t pairs = nr_tasks / 2;
+
+    hb.senders = pairs < HACKBENCH_GROUP_SENDERS ? pairs : HACKBENCH_GROUP_SENDERS;
+    hb.next_sender = 0;
+    hb.next_receiver = 0;
+    atomic64_set(&hb.switches, 0);
+    hb.go = false;
+    init_waitqueue_head(&hb.start_wq);
+
+    for (uint32_t i = 0; i < pairs; i++) {
+        hb.channels[i] = channel_create(HACKBENCH_MSG_SIZE, HACKBENCH_DEPTH);
+        if (!hb.channels[i]) {
+            console_printf("BENCH name=%s error=nomem\n", name);
+            while (i-- > 0) {
+                channel_destroy(hb.channels[i]);
+            }
+            return;
+        }
+    }
+
+    /* A missing task would leave its peers blocked forever: spawn all or
+     * close the channels so the ones that exist drain and exit */
+    bench_sync_init(nr_tasks);
+    bool complete = true;
+    for (uint32_t i = 0; i < pairs; i++) {
+        if (!bench_spawn("hb_recv", hackbench_receiver, 0, MAX_CPUS)) {
+            bench_sync_done();
+            complete = false;
+        }
+        if (!bench_spawn("hb_send", hackbench_sender, 0, MAX_CPUS)) {
+            bench_sync_done();
+            complete = false;
+        }
+    }
+
+    uint64_t start = timer_get_ns();
+    hb.go = true;
+    wake_up(&hb.start_wq);
+
+    if (!complete) {
+        console_printf("BENCH name=%s error=spawn\n", name);
+        for (uint32_t i = 0; i < pairs; i++) {
+            channel_close(hb.channels[i]);
+        }
+    }
+    bench_sync_wait();
+    uint64_t elapsed = timer_get_ns() - start;
+
+    for (uint32_t i = 0; i < pairs; i++) {
+        channel_destroy(hb.channels[i]);
+    }
+
+    if (complete && elapsed > 0) {
+        uint64_t msgs = (uint64_t)pairs * hb.senders * HACKBENCH_LOOPS;
+        bench_report_metric(name, "msgs_per_sec", msgs * NSEC_PER_SEC / elapsed);
+        bench_report_metric(name, "switches_per_sec", (uint64_t)atomic64_read(&hb.switches) * NSEC_PER_SEC / elapsed);
+        bench_report_metric(name, "elapsed_us", elapsed / NSEC_PER_USEC);
+    }
+}
+
+void hackbench_run(void) {
+    static const char* const names[] = {
+        "hackbench_2", "hackbench_4", "hackbench_8", "hackbench_16",
+        "hackbench_32", "hackbench_64", "hackbench_128", "hackbench_256",
+    };
+
+    uint32_t tasks = 2;
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++, tasks *= 2) {
+        if (tasks > HACKBENCH_MAX_TASKS) {
+            break;
+        }
+        run_hackbench(names[i], tasks);
+    }
+}
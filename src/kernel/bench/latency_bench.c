@@ -0,0 +1,206 @@
+/**
+ * Wakeup Latency Benchmark (cyclictest style)
+ *
+ * One SCHED_FIFO task per online CPU sleeps until absolute times on a
+ * fixed period and records how late it actually ran, in ns of
+ * timer_get_ns(). This covers the timer interrupt, wake_up_process(),
+ * RT preemption and the switch itself. It runs twice: on otherwise idle
+ * CPUs, then against fair-class load on every CPU (yield storms, stack
+ * and page allocator churn, console output, all of which take locks with
+ * IRQs disabled).
+ */
+
+#include <kernel/bench.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/mm.h>
+#include <kernel/smp.h>
+
+#ifndef LAT_BENCH_LOOPS
+#define LAT_BENCH_LOOPS         2000
+#endif
+
+#define LAT_BENCH_INTERVAL_NS   (1000 * NSEC_PER_USEC)
+#define LAT_BENCH_PRIO          (MAX_RT_PRIO - 1)
+
+/* Jitter budget: samples above it are counted in "over_budget" */
+#define LAT_BENCH_BUDGET_NS     (100 * NSEC_PER_USEC)
+
+/* Load tasks per CPU */
+#define LAT_LOAD_YIELDERS       2
+#define LAT_CONSOLE_BURST       8       /* Lines per burst of console output */
+
+static struct {
+    bench_hist_t hist[MAX_CPUS];
+    char names[MAX_CPUS][40];
+    uint64_t over_budget[MAX_CPUS];
+    uint64_t start;                     /* Common time base of all periods */
+    uint32_t measuring;                 /* Measuring tasks not yet done */
+    volatile bool stop;                 /* Tells the load tasks to exit */
+} lb;
+
+/******************************************************************************
+ * Measurement
+ *****************************************************************************/
+
+static void lat_measure(void) {
+    uint32_t cpu = smp_processor_id();
+    bench_hist_t* hist = &lb.hist[cpu];
+
+    /* Stagger the CPUs so their timers do not all fire together */
+    uint64_t next = lb.start + cpu * (LAT_BENCH_INTERVAL_NS / MAX_CPUS);
+
+    for (uint32_t i = 0; i < LAT_BENCH_LOOPS; i++) {
+        next += LAT_BENCH_INTERVAL_NS;
+        task_sleep_until(next);
+        uint64_t now = timer_get_ns();
+
+        bench_hist_add(hist, now - next);
+        if (now - next > LAT_BENCH_BUDGET_NS) {
+            lb.over_budget[cpu]++;
+        }
+
+        /* Missed whole periods: resume on the grid */
+        while (next + LAT_BENCH_INTERVAL_NS <= now) {
+            next += LAT_BENCH_INTERVAL_NS;
+        }
+    }
+
+    if (__atomic_sub_fetch(&lb.measuring, 1, __ATOMIC_ACQ_REL) == 0) {
+        lb.stop = true;
+    }
+    bench_sync_done();
+}
+
+/******************************************************************************
+ * Load
+ *****************************************************************************/
+
+static void load_yield(void) {
+    while (!lb.stop) {
+        task_yield();
+    }
+    bench_sync_done();
+}
+
+/* Per-CPU stack cache refills and the page allocator lock */
+static void load_alloc(void) {
+    static const uint32_t stack_sizes[] = { STACK_SIZE_MIN, 8 * 1024, STACK_SIZE_MAX };
+
+    for (uint32_t i = 0; !lb.stop; i++) {
+        uint32_t size = stack_sizes[i % 3];
+        void* stack = stack_alloc(size);
+        if (stack) {
+            stack_free(stack, size);
+        }
+
+        uint64_t pages = 1 + (i & 7);
+        void* mem = pmm_alloc_pages(pages);
+        if (mem) {
+            pmm_free_pages_at(mem, pages);
+        }
+
+        if ((i & 63) == 0) {
+            task_yield();
+        }
+    }
+    bench_sync_done();
+}
+
+/* Console lock held with IRQs disabled for a whole line */
+static void load_console(void) {
+    for (uint32_t i = 0; !lb.stop; i++) {
+        console_printf("lat_bench: load line %u\n", i);
+        if (i % LAT_CONSOLE_BURST == LAT_CONSOLE_BURST - 1) {
+            task_sleep_ns(NSEC_PER_MSEC);
+        }
+    }
+    bench_sync_done();
+}
+
+/******************************************************************************
+ * Suite
+ *****************************************************************************/
+
+/* prefix + "_cpu" + number */
+static const char* cpu_name(char* buf, const char* prefix, uint32_t cpu) {
+    char* p = buf;
+    while (*prefix) {
+        *p++ = *prefix++;
+    }
+    *p++ = '_';
+    *p++ = 'c';
+    *p++ = 'p';
+    *p++ = 'u';
+    if (cpu >= 10) {
+        *p++ = '0' + cpu / 10;
+    }
+    *p++ = '0' + cpu % 10;
+    *p = '\0';
+    return buf;
+}
+
+static void run_latency(const char* name, bool load) {
+    uint32_t nr_cpus = smp_num_cpus();
+    uint32_t nr_tasks = 0;
+
+    /* Upper bound: measurer, yielders and allocator per CPU, one console */
+    uint32_t max_tasks = nr_cpus * (LAT_LOAD_YIELDERS + 2) + 1;
+
+    lb.stop = false;
+    lb.measuring = nr_cpus;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (smp_cpu_online(cpu)) {
+            bench_hist_init(&lb.hist[cpu], cpu_name(lb.names[cpu], name, cpu));
+            lb.hist[cpu].unit = "ns";
+            lb.over_budget[cpu] = 0;
+        }
+    }
+
+    bench_sync_init(max_tasks);
+
+    if (load) {
+        for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (!smp_cpu_online(cpu)) {
+                continue;
+            }
+            for (uint32_t i = 0; i < LAT_LOAD_YIELDERS; i++) {
+                nr_tasks += bench_spawn("lat_yield", load_yield, 0, cpu) != NULL;
+            }
+            nr_tasks += bench_spawn("lat_alloc", load_alloc, 0, cpu) != NULL;
+        }
+        nr_tasks += bench_spawn("lat_console", load_console, 0, bench_cpu(0)) != NULL;
+    }
+
+    /* First period starts once every measurer is surely queued */
+    lb.start = timer_get_ns() + 10 * NSEC_PER_MSEC;
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!smp_cpu_online(cpu)) {
+            continue;
+        }
+        if (bench_spawn("lat_measure", lat_measure, LAT_BENCH_PRIO, cpu)) {
+            nr_tasks++;
+        } else if (__atomic_sub_fetch(&lb.measuring, 1, __ATOMIC_ACQ_REL) == 0) {
+            lb.stop = true;
+        }
+    }
+
+    /* Account for the tasks that were never created */
+    for (uint32_t i = nr_tasks; i < max_tasks; i++) {
+        bench_sync_done();
+    }
+    bench_sync_wait();
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (smp_cpu_online(cpu)) {
+            bench_hist_report(&lb.hist[cpu]);
+            bench_report_metric(lb.names[cpu], "over_budget", lb.over_budget[cpu]);
+        }
+    }
+}
+
+void latency_bench_run(void) {
+    run_latency("wakeup_latency_idle", false);
+    run_latency("wakeup_latency_loaded", true);
+}
@@ -0,0 +1,216 @@
+/**
+ * Scheduler Microbenchmarks
+ *
+ * yield_pingpong_*: two tasks on one CPU take turns in task_yield(); a
+ *     sample is the time from one task entering task_yield() to the other
+ *     returning from it (schedule() plus switch_to()).
+ * yield_storm_N: the same with N fair tasks on one CPU, plus the overall
+ *     switch rate.
+ * wake_to_run_*: a SCHED_FIFO task blocked on a wait queue is woken by a
+ *     fair task, on the same CPU or on another one; a sample is the time
+ *     from wake_up() to the sleeper running.
+ */
+
+#include <kernel/bench.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/mm.h>
+#include <kernel/smp.h>
+#include <kernel/wait.h>
+#include <arch/interrupts.h>
+
+#ifndef SCHED_BENCH_ITERATIONS
+#define SCHED_BENCH_ITERATIONS  2000
+#endif
+
+#define SCHED_BENCH_RT_PRIO     40
+
+/* Yield storms: fair tasks sharing one CPU */
+static const struct {
+    const char* name;
+    uint32_t tasks;
+} storms[] = {
+    { "yield_storm_2",  2  },
+    { "yield_storm_4",  4  },
+    { "yield_storm_8",  8  },
+    { "yield_storm_16", 16 },
+    { "yield_storm_32", 32 },
+};
+
+/* Record a sample; tasks sharing a histogram may preempt each other */
+static void record(bench_hist_t* hist, uint64_t cycles) {
+    uint64_t flags = interrupts_save();
+    bench_hist_add(hist, cycles);
+    interrupts_restore(flags);
+}
+
+/******************************************************************************
+ * Yield Ping-pong and Storms
+ *****************************************************************************/
+
+static struct {
+    bench_hist_t hist;
+    volatile uint64_t stamp;    /* When owner entered task_yield() */
+    volatile uint32_t owner;    /* Task that yielded last */
+    uint32_t nr_tasks;
+    uint32_t next_id;
+    uint32_t started;           /* Tasks past the start barrier */
+    uint32_t finished;
+    uint64_t start;             /* Cycles when the last task got going */
+    uint64_t end;               /* Cycles when the last task finished */
+} yb;
+
+static void yield_worker(void) {
+    uint32_t me = __atomic_fetch_add(&yb.next_id, 1, __ATOMIC_RELAXED);
+
+    /* Everyone is queued on the CPU before measuring */
+    if (__atomic_add_fetch(&yb.started, 1, __ATOMIC_ACQ_REL) == yb.nr_tasks) {
+        yb.start = bench_cycles();
+    }
+    while (__atomic_load_n(&yb.started, __ATOMIC_ACQUIRE) < yb.nr_tasks) {
+        task_yield();
+    }
+
+    for (uint32_t i = 0; i < SCHED_BENCH_ITERATIONS; i++) {
+        yb.owner = me;
+        yb.stamp = bench_cycles();
+        task_yield();
+        uint64_t now = bench_cycles();
+
+        /* Another task ran in between (not so once the others are done) */
+        if (yb.owner != me) {
+            record(&yb.hist, now - yb.stamp);
+        }
+    }
+
+    if (__atomic_add_fetch(&yb.finished, 1, __ATOMIC_ACQ_REL) == yb.nr_tasks) {
+        yb.end = bench_cycles();
+    }
+    bench_sync_done();
+}
+
+/* nr_tasks tasks yielding to each other on one CPU */
+static void run_yield(const char* name, uint32_t nr_tasks, uint8_t rt_priority) {
+    if (bench_hist_init(&yb.hist, name) < 0) {
+        return;
+    }
+    yb.nr_tasks = nr_tasks;
+    yb.next_id = 0;
+    yb.started = 0;
+    yb.finished = 0;
+    yb.owner = ~0U;
+
+    uint32_t cpu = bench_cpu(0);
+    bench_sync_init(nr_tasks);
+    for (uint32_t i = 0; i < nr_tasks; i++) {
+        if (!bench_spawn("bench_yield", yield_worker, rt_priority, cpu)) {
+            bench_sync_done();  /* Count it as finished */
+            __atomic_add_fetch(&yb.started, 1, __ATOMIC_ACQ_REL);
+        }
+    }
+    bench_sync_wait();
+
+    bench_hist_report(&yb.hist);
+
+    uint64_t elapsed = yb.end - yb.start;
+    if (elapsed > 0) {
+        uint64_t switches = (uint64_t)nr_tasks * SCHED_BENCH_ITERATIONS;
+        bench_report_metric(name, "switches_per_sec",
+                            switches * bench_counter_hz() / elapsed);
+    }
+}
+
+/******************************************************************************
+ * Wake to Run
+ *****************************************************************************/
+
+static struct {
+    bench_hist_t hist;
+    wait_queue_head_t wq;       /* Sleeper blocks here */
+    wait_queue_head_t ack_wq;   /* Waker blocks here until the sleeper ran */
+    task_struct_t* sleeper;
+    volatile uint64_t stamp;    /* When wake_up() was called */
+    volatile bool pending;      /* Wakeup posted, sleeper has not run yet */
+    volatile bool abort;        /* No waker: the sleeper exits early */
+} wb;
+
+static void wake_sleeper(void) {
+    for (uint32_t i = 0; i < SCHED_BENCH_ITERATIONS; i++) {
+        wait_event(wb.wq, wb.pending || wb.abort);
+        if (wb.abort) {
+            break;
+        }
+        uint64_t now = bench_cycles();
+
+        record(&wb.hist, now - wb.stamp);
+        wb.pending = false;
+        wake_up(&wb.ack_wq);
+    }
+    bench_sync_done();
+}
+
+static void wake_waker(void) {
+    for (uint32_t i = 0; i < SCHED_BENCH_ITERATIONS; i++) {
+        /* Wait until the sleeper is really off its CPU */
+        while (wb.sleeper->state != TASK_BLOCKED ||
+               __atomic_load_n(&wb.sleeper->on_cpu, __ATOMIC_ACQUIRE)) {
+            task_yield();
+        }
+
+        wb.stamp = bench_cycles();
+        wb.pending = true;
+        wake_up(&wb.wq);
+
+        wait_event(wb.ack_wq, !wb.pending);
+    }
+    bench_sync_done();
+}
+
+static void run_wake(const char* name, uint32_t waker_cpu, uint32_t sleeper_cpu) {
+    if (bench_hist_init(&wb.hist, name) < 0) {
+        return;
+    }
+    init_waitqueue_head(&wb.wq);
+    init_waitqueue_head(&wb.ack_wq);
+    wb.pending = false;
+    wb.abort = false;
+
+    bench_sync_init(2);
+    wb.sleeper = bench_spawn("bench_sleeper", wake_sleeper, SCHED_BENCH_RT_PRIO, sleeper_cpu);
+    if (!wb.sleeper) {
+        console_printf("BENCH name=%s error=spawn\n", name);
+        kfree(wb.hist.samples);
+        return;
+    }
+    if (!bench_spawn("bench_waker", wake_waker, 0, waker_cpu)) {
+        /* The sleeper must be off wb.wq before the next run reinitializes it */
+        console_printf("BENCH name=%s error=spawn\n", name);
+        wb.abort = true;
+        wake_up(&wb.wq);
+        bench_sync_done();
+        bench_sync_wait();
+        kfree(wb.hist.samples);
+        return;
+    }
+    bench_sync_wait();
+
+    bench_hist_report(&wb.hist);
+}
+
+/******************************************************************************
+ * Suite
+ *****************************************************************************/
+
+void sched_bench_run(void) {
+    run_yield("yield_pingpong_fifo", 2, SCHED_BENCH_RT_PRIO);
+    run_yield("yield_pingpong_cfs", 2, 0);
+
+    for (uint32_t i = 0; i < sizeof(storms) / sizeof(storms[0]); i++) {
+        run_yield(storms[i].name, storms[i].tasks, 0);
+    }
+
+    run_wake("wake_to_run_local", bench_cpu(0), bench_cpu(0));
+    if (smp_num_cpus() > 1) {
+        run_wake("wake_to_run_remote", bench_cpu(1), bench_cpu(0));
+    }
+}
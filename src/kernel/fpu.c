@@ -0,0 +1,63 @@
+/**
+ * Kernel FP/SIMD Sections - per-task state across context switches
+ *
+ * FP/SIMD access is enabled on a CPU exactly while its current task is
+ * inside a kernel_fpu_begin()/kernel_fpu_end() section. Only such tasks
+ * have their registers saved and restored; see kernel/fpu.h.
+ */
+
+#include <kernel/fpu.h>
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/preempt.h>
+#include <arch/interrupts.h>
+
+bool may_use_fpu(void) {
+    /* An IRQ handler would clobber the interrupted task's registers */
+    return !in_irq();
+}
+
+void kernel_fpu_begin(void) {
+    if (!may_use_fpu()) {
+        console_printf("ERROR: kernel_fpu_begin() in IRQ context\n");
+        return;     /* Access stays trapped: SIMD use faults */
+    }
+
+    uint64_t flags = interrupts_save();
+    task_struct_t* task = get_current_task();
+    if (task->fpu_depth++ == 0) {
+        arch_fpu_enable();
+        arch_fpu_reset();
+    }
+    interrupts_restore(flags);
+}
+
+void kernel_fpu_end(void) {
+    if (!may_use_fpu()) {
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    task_struct_t* task = get_current_task();
+    if (task->fpu_depth > 0 && --task->fpu_depth == 0) {
+        arch_fpu_disable();
+    }
+    interrupts_restore(flags);
+}
+
+/* Access is enabled iff the current task is in a section, so switching
+ * between two tasks outside sections touches nothing */
+void fpu_switch(task_struct_t* prev, task_struct_t* next) {
+    if (prev->fpu_depth) {
+        arch_fpu_save(&prev->fpu);
+    }
+
+    if (next->fpu_depth) {
+        if (!prev->fpu_depth) {
+            arch_fpu_enable();
+        }
+        arch_fpu_restore(&next->fpu);
+    } else if (prev->fpu_depth) {
+        arch_fpu_disable();
+    }
+}
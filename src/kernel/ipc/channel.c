@@ -0,0 +1,105 @@
+/**
+ * Channels - bounded message queues between tasks
+ *
+ * The ring is only touched under ch->lock. Blocking goes through the
+ * wait queues: a task that finds the ring full (empty) waits for a free
+ * slot (a message) and retries under the lock, since another task may
+ * have taken it in between. Each slot freed or filled wakes one waiter.
+ */
+
+#include <kernel/channel.h>
+#include <kernel/console.h>
+#include <kernel/mm.h>
+#include <kernel/string.h>
+#include <arch/interrupts.h>
+
+channel_t* channel_create(uint32_t msg_size, uint32_t capacity) {
+    if (msg_size == 0 || capacity == 0) {
+        console_printf("ERROR: channel_create: empty messages or ring\n");
+        return NULL;
+    }
+
+    channel_t* ch = kmalloc(sizeof(channel_t));
+    if (!ch) {
+        return NULL;
+    }
+    ch->buf = kmalloc((size_t)msg_size * capacity);
+    if (!ch->buf) {
+        kfree(ch);
+        return NULL;
+    }
+
+    spin_lock_init(&ch->lock);
+    ch->msg_size = msg_size;
+    ch->capacity = capacity;
+    ch->head = 0;
+    ch->count = 0;
+    ch->closed = false;
+    init_waitqueue_head(&ch->senders);
+    init_waitqueue_head(&ch->receivers);
+    return ch;
+}
+
+void channel_destroy(channel_t* ch) {
+    kfree(ch->buf);
+    kfree(ch);
+}
+
+int channel_send(channel_t* ch, const void* msg) {
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&ch->lock);
+
+        if (ch->closed) {
+            spin_unlock_irqrestore(&ch->lock, flags);
+            return -1;
+        }
+        if (ch->count < ch->capacity) {
+            uint32_t tail = (ch->head + ch->count) % ch->capacity;
+            memcpy(ch->buf + (size_t)tail * ch->msg_size, msg, ch->msg_size);
+            ch->count++;
+
+            spin_unlock_irqrestore(&ch->lock, flags);
+
+            wake_up_one(&ch->receivers);
+            return 0;
+        }
+
+        spin_unlock_irqrestore(&ch->lock, flags);
+
+        wait_event(ch->senders, ch->count < ch->capacity || ch->closed);
+    }
+}
+
+int channel_recv(channel_t* ch, void* msg) {
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&ch->lock);
+
+        if (ch->count > 0) {
+            memcpy(msg, ch->buf + (size_t)ch->head * ch->msg_size, ch->msg_size);
+            ch->head = (ch->head + 1) % ch->capacity;
+            ch->count--;
+
+            spin_unlock_irqrestore(&ch->lock, flags);
+
+            wake_up_one(&ch->senders);
+            return 0;
+        }
+        if (ch->closed) {
+            spin_unlock_irqrestore(&ch->lock, flags);
+            return -1;
+        }
+
+        spin_unlock_irqrestore(&ch->lock, flags);
+
+        wait_event(ch->receivers, ch->count > 0 || ch->closed);
+    }
+}
+
+void channel_close(channel_t* ch) {
+    uint64_t flags = spin_lock_irqsave(&ch->lock);
+    ch->closed = true;
+    spin_unlock_irqrestore(&ch->lock, flags);
+
+    wake_up(&ch->senders);
+    wake_up(&ch->receivers);
+}
@@ -1,6 +1,8 @@
 #include <kernel/console.h>
 #include <kernel/types.h>
 #include <kernel/string.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupts.h>
 
 // Variable arguments support
 typedef __builtin_va_list va_list;
@@ -48,10 +50,15 @@ static void print_int(int64_t num, int base, int is_signed, int width, char pad_
         console_putchar(buffer[--i]);
 }
 
+/* Keeps lines from different CPUs from interleaving */
+static spinlock_t console_lock = SPINLOCK_INIT;
+
 void console_printf(const char* fmt, ...) {
     va_list args;
     va_start(args, fmt);
 
+    uint64_t flags = spin_lock_irqsave(&console_lock);
+
     while (*fmt) {
         if (*fmt == '%') {
             fmt++;
@@ -142,6 +149,7 @@ void console_printf(const char* fmt, ...) {
         fmt++;
     }
 
+    spin_unlock_irqrestore(&console_lock, flags);
     va_end(args);
 }
 
@@ -0,0 +1,291 @@
+/**
+ * Generic Red-Black Tree Implementation
+ * Classic CLRS algorithm with parent pointers and NULL leaves (black)
+ */
+
+#include <kernel/rbtree.h>
+
+/* Helper: color of a possibly-NULL node (NULL leaves are black) */
+static inline bool rb_is_red(const rb_node_t* node) {
+    return node != NULL && node->color == RB_RED;
+}
+
+/* Helper: replace old child link of parent with new_node */
+static void rb_replace_child(rb_root_t* root, rb_node_t* parent,
+                             rb_node_t* old, rb_node_t* new_node) {
+    if (parent == NULL) {
+        root->node = new_node;
+    } else if (parent->left == old) {
+        parent->left = new_node;
+    } else {
+        parent->right = new_node;
+    }
+}
+
+/* Rotate x down to the left (x->right becomes the subtree root) */
+static void rb_rotate_left(rb_root_t* root, rb_node_t* x) {
+    rb_node_t* y = x->right;
+
+    x->right = y->left;
+    if (y->left) {
+        y->left->parent = x;
+    }
+    y->parent = x->parent;
+    rb_replace_child(root, x->parent, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+/* Rotate x down to the right (x->left becomes the subtree root) */
+static void rb_rotate_right(rb_root_t* root, rb_node_t* x) {
+    rb_node_t* y = x->left;
+
+    x->left = y->right;
+    if (y->right) {
+        y->right->parent = x;
+    }
+    y->parent = x->parent;
+    rb_replace_child(root, x->parent, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+/* Restore red-black invariants after inserting red node z */
+static void rb_insert_fixup(rb_root_t* root, rb_node_t* z) {
+    while (rb_is_red(z->parent)) {
+        rb_node_t* parent = z->parent;
+        rb_node_t* gparent = parent->parent;  /* Red parent is never the root */
+
+        if (parent == gparent->left) {
+            rb_node_t* uncle = gparent->right;
+            if (rb_is_red(uncle)) {
+                /* Case 1: recolor and move up */
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                z = gparent;
+                continue;
+            }
+            if (z == parent->right) {
+                /* Case 2: rotate into case 3 */
+                rb_rotate_left(root, parent);
+                z = parent;
+                parent = z->parent;
+            }
+            /* Case 3 */
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_right(root, gparent);
+        } else {
+            rb_node_t* uncle = gparent->left;
+            if (rb_is_red(uncle)) {
+                parent->color = RB_BLACK;
+                uncle->color = RB_BLACK;
+                gparent->color = RB_RED;
+                z = gparent;
+                continue;
+            }
+            if (z == parent->left) {
+                rb_rotate_right(root, parent);
+                z = parent;
+                parent = z->parent;
+            }
+            parent->color = RB_BLACK;
+            gparent->color = RB_RED;
+            rb_rotate_left(root, gparent);
+        }
+    }
+    root->node->color = RB_BLACK;
+}
+
+/**
+ * Insert a node into the tree
+ */
+void rb_insert(rb_root_t* root, rb_node_t* node, rb_less_t less) {
+    rb_node_t** link = &root->node;
+    rb_node_t* parent = NULL;
+    bool leftmost = true;
+
+    /* Walk down to the insertion point */
+    while (*link) {
+        parent = *link;
+        if (less(node, parent)) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RB_RED;
+    *link = node;
+
+    if (leftmost) {
+        root->leftmost = node;
+    }
+
+    rb_insert_fixup(root, node);
+}
+
+/* Restore red-black invariants after removing a black node; x replaced it under parent */
+static void rb_delete_fixup(rb_root_t* root, rb_node_t* x, rb_node_t* parent) {
+    while (x != root->node && !rb_is_red(x)) {
+        if (x == parent->left) {
+            rb_node_t* w = parent->right;
+            if (rb_is_red(w)) {
+                w->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_left(root, parent);
+                w = parent->right;
+            }
+            if (!rb_is_red(w->left) && !rb_is_red(w->right)) {
+                w->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!rb_is_red(w->right)) {
+                    w->left->color = RB_BLACK;
+                    w->color = RB_RED;
+                    rb_rotate_right(root, w);
+                    w = parent->right;
+                }
+                w->color = parent->color;
+                parent->color = RB_BLACK;
+                if (w->right) {
+                    w->right->color = RB_BLACK;
+                }
+                rb_rotate_left(root, parent);
+                x = root->node;
+                break;
+            }
+        } else {
+            rb_node_t* w = parent->left;
+            if (rb_is_red(w)) {
+                w->color = RB_BLACK;
+                parent->color = RB_RED;
+                rb_rotate_right(root, parent);
+                w = parent->left;
+            }
+            if (!rb_is_red(w->right) && !rb_is_red(w->left)) {
+                w->color = RB_RED;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!rb_is_red(w->left)) {
+                    w->right->color = RB_BLACK;
+                    w->color = RB_RED;
+                    rb_rotate_left(root, w);
+                    w = parent->left;
+                }
+                w->color = parent->color;
+                parent->color = RB_BLACK;
+                if (w->left) {
+                    w->left->color = RB_BLACK;
+                }
+                rb_rotate_right(root, parent);
+                x = root->node;
+                break;
+            }
+        }
+    }
+    if (x) {
+        x->color = RB_BLACK;
+    }
+}
+
+/**
+ * Remove a node from the tree
+ */
+void rb_delete(rb_root_t* root, rb_node_t* node) {
+    rb_node_t* child;
+    rb_node_t* parent;
+    uint8_t removed_color;
+
+    /* Keep the leftmost cache valid: successor of leftmost is the new leftmost */
+    if (root->leftmost == node) {
+        root->leftmost = rb_next(node);
+    }
+
+    if (node->left == NULL || node->right == NULL) {
+        /* At most one child: splice node out directly */
+        child = node->left ? node->left : node->right;
+        parent = node->parent;
+        removed_color = node->color;
+
+        if (child) {
+            child->parent = parent;
+        }
+        rb_replace_child(root, parent, node, child);
+    } else {
+        /* Two children: move in-order successor into node's position */
+        rb_node_t* succ = node->right;
+        while (succ->left) {
+            succ = succ->left;
+        }
+
+        child = succ->right;
+        removed_color = succ->color;
+
+        if (succ->parent == node) {
+            parent = succ;
+        } else {
+            parent = succ->parent;
+            parent->left = child;
+            if (child) {
+                child->parent = parent;
+            }
+            succ->right = node->right;
+            node->right->parent = succ;
+        }
+
+        succ->left = node->left;
+        node->left->parent = succ;
+        succ->parent = node->parent;
+        succ->color = node->color;
+        rb_replace_child(root, node->parent, node, succ);
+    }
+
+    node->parent = node->left = node->right = NULL;
+
+    if (removed_color == RB_BLACK) {
+        rb_delete_fixup(root, child, parent);
+    }
+}
+
+/**
+ * Get the smallest node
+ */
+rb_node_t* rb_first(const rb_root_t* root) {
+    rb_node_t* node = root->node;
+    if (node == NULL) {
+        return NULL;
+    }
+    while (node->left) {
+        node = node->left;
+    }
+    return node;
+}
+
+/**
+ * Get the in-order successor
+ */
+rb_node_t* rb_next(const rb_node_t* node) {
+    if (node->right) {
+        node = node->right;
+        while (node->left) {
+            node = node->left;
+        }
+        return (rb_node_t*)node;
+    }
+
+    /* Climb until we come up from a left subtree */
+    rb_node_t* parent = node->parent;
+    while (parent && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return parent;
+}
@@ -0,0 +1,40 @@
+/**
+ * Vectorized Kernels (built with FP/SIMD enabled; see kernel/simd.h)
+ *
+ * Written with GCC vector types, so one source gives SSE2 on x86_64 and
+ * NEON on ARM64.
+ */
+
+#include <kernel/simd.h>
+
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+
+/* Same, for loads from any alignment */
+typedef uint32_t v4u32_unaligned __attribute__((vector_size(16), aligned(1)));
+
+uint32_t simd_csum32(const void* buf, size_t len) {
+    const uint8_t* p = buf;
+    v4u32 acc0 = { 0 }, acc1 = { 0 }, acc2 = { 0 }, acc3 = { 0 };
+
+    /* Four independent accumulators keep the adders busy */
+    for (; len >= 64; p += 64, len -= 64) {
+        acc0 += *(const v4u32_unaligned*)(p + 0);
+        acc1 += *(const v4u32_unaligned*)(p + 16);
+        acc2 += *(const v4u32_unaligned*)(p + 32);
+        acc3 += *(const v4u32_unaligned*)(p + 48);
+    }
+    for (; len >= 16; p += 16, len -= 16) {
+        acc0 += *(const v4u32_unaligned*)p;
+    }
+
+    v4u32 acc = acc0 + acc1 + acc2 + acc3;
+    uint32_t sum = acc[0] + acc[1] + acc[2] + acc[3];
+
+    for (; len >= 4; p += 4, len -= 4) {
+        sum += (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+    for (uint32_t shift = 0; len > 0; p++, len--, shift += 8) {
+        sum += (uint32_t)*p << shift;
+    }
+    return sum;
+}
@@ -0,0 +1,23 @@
+/**
+ * Spinlock Contention Statistics
+ */
+
+#include <kernel/spinlock.h>
+#include <kernel/console.h>
+
+void spin_lock_stats_report(const char* name, uint32_t instance, spinlock_t* lock) {
+#ifdef SPINLOCK_STATS
+    /* Snapshot: the counters are only written by the holder */
+    uint64_t flags = spin_lock_irqsave(lock);
+    spinlock_stats_t stats = lock->stats;
+    spin_unlock_irqrestore(lock, flags);
+
+    console_printf("LOCK_STATS name=%s instance=%u acquisitions=%llu contended=%llu "
+                   "spin_cycles=%llu\n",
+                   name, instance, stats.acquisitions, stats.contended, stats.spin_cycles);
+#else
+    (void)name;
+    (void)instance;
+    (void)lock;
+#endif
+}
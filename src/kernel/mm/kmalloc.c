@@ -5,6 +5,7 @@
 
 #include <kernel/mm.h>
 #include <kernel/string.h>
+#include <kernel/spinlock.h>
 
 #define HEAP_MAGIC 0xDEADBEEF  /* Magic number for debugging */
 
@@ -25,6 +26,9 @@ static mem_block_t* free_list = NULL;  /* Head of free block list */
 static uint64_t total_heap_size = 0;
 static uint64_t used_heap_size = 0;
 
+/* Protects the block list and counters (taken with IRQs disabled) */
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
 /**
  * Initialize the kernel heap allocator
  */
@@ -95,9 +99,12 @@ void* kmalloc(size_t size)
     /* Align size to 8 bytes */
     size = (size + 7) & ~7;
 
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+
     /* Find a free block */
     mem_block_t* block = find_free_block(size);
     if (block == NULL) {
+        spin_unlock_irqrestore(&heap_lock, flags);
         return NULL;  /* Out of memory */
     }
 
@@ -108,6 +115,8 @@ void* kmalloc(size_t size)
     block->allocated = 1;
     used_heap_size += block->size + BLOCK_HEADER_SIZE;
 
+    spin_unlock_irqrestore(&heap_lock, flags);
+
     /* Return pointer to usable data (after header) */
     return (void*)((uint64_t)block + BLOCK_HEADER_SIZE);
 }
@@ -158,8 +167,11 @@ void kfree(void* ptr)
         return;  /* Invalid pointer or corrupted heap */
     }
 
+    uint64_t flags = spin_lock_irqsave(&heap_lock);
+
     /* Check if already freed */
     if (!block->allocated) {
+        spin_unlock_irqrestore(&heap_lock, flags);
         return;  /* Double free */
     }
 
@@ -167,6 +179,8 @@ void kfree(void* ptr)
     block->allocated = 0;
     used_heap_size -= block->size + BLOCK_HEADER_SIZE;
 
+    spin_unlock_irqrestore(&heap_lock, flags);
+
     /* Coalesce with adjacent free blocks */
     /* Simple implementation: just mark as free and add to free list */
     /* (A more sophisticated implementation would merge adjacent free blocks) */
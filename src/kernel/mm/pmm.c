@@ -5,7 +5,9 @@
  */
 
 #include <kernel/mm.h>
+#include <kernel/spinlock.h>
 #include <kernel/string.h>
+#include <arch/interrupts.h>
 
 /* Bitmap to track page allocation status */
 static uint64_t* pmm_bitmap = NULL;
@@ -14,6 +16,9 @@ static uint64_t pmm_free_pages = 0;
 static uint64_t pmm_mem_start = 0;
 static uint64_t pmm_mem_end = 0;
 
+/* Allocations may come from any CPU, also with IRQs disabled */
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
 /* Bitmap manipulation macros */
 #define BITMAP_INDEX(page) ((page) / 64)
 #define BITMAP_OFFSET(page) ((page) % 64)
@@ -62,25 +67,44 @@ void pmm_init(uint64_t mem_start, uint64_t mem_end)
  */
 void* pmm_alloc_page(void)
 {
-    if (pmm_free_pages == 0) {
-        return NULL;  /* Out of memory */
-    }
+    return pmm_alloc_pages(1);
+}
+
+/**
+ * Allocate physically contiguous pages (first fit)
+ */
+void* pmm_alloc_pages(uint64_t count)
+{
+    void* addr = NULL;
 
-    /* Search for a free page in the bitmap */
-    for (uint64_t i = 0; i < pmm_total_pages; i++) {
-        if (!BITMAP_TEST(i)) {
-            /* Found a free page */
-            BITMAP_SET(i);
-            pmm_free_pages--;
+    if (count == 0) {
+        return NULL;
+    }
 
-            /* Calculate physical address of this page */
-            uint64_t phys_addr = pmm_mem_start + (i * PAGE_SIZE);
-            return (void*)phys_addr;
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+
+    if (pmm_free_pages >= count) {
+        /* Search for a run of count free pages in the bitmap */
+        uint64_t run = 0;
+        for (uint64_t i = 0; i < pmm_total_pages; i++) {
+            run = BITMAP_TEST(i) ? 0 : run + 1;
+            if (run == count) {
+                /* Found one: pages i-count+1 .. i */
+                uint64_t first = i + 1 - count;
+                for (uint64_t j = first; j <= i; j++) {
+                    BITMAP_SET(j);
+                }
+                pmm_free_pages -= count;
+
+                /* Calculate physical address of the first page */
+                addr = (void*)(pmm_mem_start + (first * PAGE_SIZE));
+                break;
+            }
         }
     }
 
-    /* Should never reach here if pmm_free_pages was accurate */
-    return NULL;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return addr;
 }
 
 /**
@@ -88,28 +112,40 @@ void* pmm_alloc_page(void)
  */
 void pmm_free_page(void* page)
 {
-    if (page == NULL) {
+    pmm_free_pages_at(page, 1);
+}
+
+/**
+ * Free pages allocated with pmm_alloc_pages()
+ */
+void pmm_free_pages_at(void* pages, uint64_t count)
+{
+    if (pages == NULL) {
         return;
     }
 
-    uint64_t phys_addr = (uint64_t)page;
+    uint64_t phys_addr = (uint64_t)pages;
 
-    /* Validate that address is within managed range */
-    if (phys_addr < pmm_mem_start || phys_addr >= pmm_mem_end) {
+    /* Validate that the range is within managed memory */
+    if (phys_addr < pmm_mem_start || phys_addr >= pmm_mem_end ||
+        count > (pmm_mem_end - phys_addr) / PAGE_SIZE) {
         return;  /* Invalid address */
     }
 
-    /* Calculate page index */
+    /* Calculate index of the first page */
     uint64_t page_index = (phys_addr - pmm_mem_start) / PAGE_SIZE;
 
-    /* Check if page is actually allocated */
-    if (!BITMAP_TEST(page_index)) {
-        return;  /* Double free or invalid */
+    uint64_t flags = spin_lock_irqsave(&pmm_lock);
+
+    for (uint64_t i = page_index; i < page_index + count; i++) {
+        /* Skip pages that are not allocated (double free or invalid) */
+        if (BITMAP_TEST(i)) {
+            BITMAP_CLEAR(i);
+            pmm_free_pages++;
+        }
     }
 
-    /* Mark page as free */
-    BITMAP_CLEAR(page_index);
-    pmm_free_pages++;
+    spin_unlock_irqrestore(&pmm_lock, flags);
 }
 
 /**
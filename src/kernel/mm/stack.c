@@ -0,0 +1,163 @@
+/**
+ * Kernel Stack Cache
+ * Per-CPU free lists of ready-made stacks in three sizes (4/8/16 KB),
+ * carved from whole pages so they never fragment the kmalloc heap.
+ * A free stack links to the next one through its lowest word.
+ */
+
+#include <kernel/mm.h>
+#include <kernel/smp.h>
+#include <arch/interrupts.h>
+
+#define STACK_CLASSES       3   /* 4, 8 and 16 KB */
+#define STACK_CACHE_MAX     16  /* Cached stacks per class and CPU before trimming */
+#define STACK_CACHE_BATCH   4   /* Stacks moved per refill or trim */
+
+_Static_assert(STACK_SIZE_MAX == STACK_SIZE_MIN << (STACK_CLASSES - 1),
+               "one cache class per power of two between the min and max size");
+
+typedef struct stack_cache {
+    void* free[STACK_CLASSES];      /* Free stacks per class, linked through word 0 */
+    uint32_t count[STACK_CLASSES];  /* Length of each list */
+    uint64_t allocs;                /* stack_alloc() calls on this CPU */
+    uint64_t frees;                 /* stack_free() calls on this CPU */
+} stack_cache_t;
+
+/* Only touched by its own CPU, with IRQs disabled */
+static stack_cache_t stack_caches[MAX_CPUS];
+
+/**
+ * Size class of a rounded stack size
+ */
+static uint32_t stack_class(uint32_t size)
+{
+    uint32_t class = 0;
+    while ((STACK_SIZE_MIN << class) < size) {
+        class++;
+    }
+    return class;
+}
+
+/**
+ * Round a stack size up to the size actually allocated
+ */
+uint32_t stack_size_round(uint32_t size)
+{
+    if (size <= STACK_SIZE_MAX) {
+        return STACK_SIZE_MIN << stack_class(size);
+    }
+    return (size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+/**
+ * Pop a cached stack, refilling the list from the page allocator if empty
+ */
+static void* stack_cache_pop(stack_cache_t* cache, uint32_t class)
+{
+    uint64_t pages = (STACK_SIZE_MIN << class) / PAGE_SIZE;
+
+    while (cache->count[class] < STACK_CACHE_BATCH) {
+        void** stack = (void**)pmm_alloc_pages(pages);
+        if (stack == NULL) {
+            break;  /* Hand out what we have */
+        }
+        *stack = cache->free[class];
+        cache->free[class] = stack;
+        cache->count[class]++;
+    }
+
+    void** stack = (void**)cache->free[class];
+    if (stack != NULL) {
+        cache->free[class] = *stack;
+        cache->count[class]--;
+    }
+    return stack;
+}
+
+/**
+ * Push a stack, trimming the list back to the page allocator if it grew too long
+ */
+static void stack_cache_push(stack_cache_t* cache, uint32_t class, void* stack)
+{
+    uint64_t pages = (STACK_SIZE_MIN << class) / PAGE_SIZE;
+
+    *(void**)stack = cache->free[class];
+    cache->free[class] = stack;
+    cache->count[class]++;
+
+    if (cache->count[class] > STACK_CACHE_MAX) {
+        for (uint32_t i = 0; i < STACK_CACHE_BATCH; i++) {
+            void** victim = (void**)cache->free[class];
+            cache->free[class] = *victim;
+            cache->count[class]--;
+            pmm_free_pages_at(victim, pages);
+        }
+    }
+}
+
+/**
+ * Allocate a kernel stack
+ */
+void* stack_alloc(uint32_t size)
+{
+    if (size == 0) {
+        return NULL;
+    }
+
+    size = stack_size_round(size);
+    if (size > STACK_SIZE_MAX) {
+        return pmm_alloc_pages(size / PAGE_SIZE);  /* Rare: not cached */
+    }
+
+    uint64_t flags = interrupts_save();
+    stack_cache_t* cache = &stack_caches[smp_processor_id()];
+    void* stack = stack_cache_pop(cache, stack_class(size));
+    if (stack != NULL) {
+        cache->allocs++;
+    }
+    interrupts_restore(flags);
+
+    return stack;
+}
+
+/**
+ * Free a kernel stack (into the calling CPU's cache)
+ */
+void stack_free(void* stack, uint32_t size)
+{
+    if (stack == NULL) {
+        return;
+    }
+
+    size = stack_size_round(size);
+    if (size > STACK_SIZE_MAX) {
+        pmm_free_pages_at(stack, size / PAGE_SIZE);
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    stack_cache_t* cache = &stack_caches[smp_processor_id()];
+    stack_cache_push(cache, stack_class(size), stack);
+    cache->frees++;
+    interrupts_restore(flags);
+}
+
+/**
+ * Get stack cache statistics
+ */
+void stack_cache_stats(uint64_t* cached, uint64_t* in_use)
+{
+    uint64_t nr_cached = 0, allocs = 0, frees = 0;
+
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        stack_cache_t* cache = &stack_caches[cpu];
+        for (uint32_t class = 0; class < STACK_CLASSES; class++) {
+            nr_cached += cache->count[class];
+        }
+        allocs += cache->allocs;
+        frees += cache->frees;
+    }
+
+    if (cached) *cached = nr_cached;
+    if (in_use) *in_use = allocs - frees;
+}
@@ -0,0 +1,114 @@
+/**
+ * Futexes
+ *
+ * Each waiter queues a futex_q on its stack in the bucket its address
+ * hashes to, then blocks. futex_wake() unlinks the waiters it wakes, so
+ * a waiter that finds itself unlinked was woken; one still queued was
+ * woken by its timeout or spuriously. Different addresses may share a
+ * bucket, so both sides compare the address of every queued waiter.
+ */
+
+#include <kernel/futex.h>
+#include <kernel/list.h>
+#include <kernel/hrtimer.h>
+#include <kernel/preempt.h>
+#include <kernel/sched.h>
+#include <kernel/spinlock.h>
+
+#define FUTEX_HASH_BITS     6
+#define FUTEX_HASH_SIZE     (1U << FUTEX_HASH_BITS)
+
+/* One cache line each: waits on unrelated words do not share a line */
+typedef struct futex_bucket {
+    spinlock_t lock;            /* Taken with IRQs disabled */
+    list_head_t waiters;        /* futex_q_t, oldest first */
+} __attribute__((aligned(64))) futex_bucket_t;
+
+typedef struct futex_q {
+    list_head_t node;           /* In the bucket (empty once woken) */
+    volatile uint32_t* addr;
+    task_struct_t* task;
+} futex_q_t;
+
+static futex_bucket_t futex_table[FUTEX_HASH_SIZE];
+
+/* Fibonacci hashing of the word index */
+static futex_bucket_t* futex_bucket(volatile uint32_t* addr) {
+    uint64_t key = (uint64_t)addr >> 2;
+    return &futex_table[(key * 0x9E3779B97F4A7C15ULL) >> (64 - FUTEX_HASH_BITS)];
+}
+
+void futex_init(void) {
+    for (uint32_t i = 0; i < FUTEX_HASH_SIZE; i++) {
+        spin_lock_init(&futex_table[i].lock);
+        list_init(&futex_table[i].waiters);
+    }
+}
+
+int futex_wait(volatile uint32_t* addr, uint32_t expected, uint64_t timeout_ns) {
+    futex_q_t q = { .addr = addr, .task = get_current_task() };
+    uint64_t deadline = timeout_ns ? timer_get_ns() + timeout_ns : 0;
+    list_init(&q.node);
+
+    futex_bucket_t* hb = futex_bucket(addr);
+    uint64_t flags = spin_lock_irqsave(&hb->lock);
+
+    /* Checked under the lock a waker takes after changing the word */
+    if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) != expected) {
+        spin_unlock_irqrestore(&hb->lock, flags);
+        return -1;
+    }
+    list_add_tail(&q.node, &hb->waiters);
+
+    for (;;) {
+        set_current_state(TASK_BLOCKED);
+        spin_unlock_irqrestore(&hb->lock, flags);
+
+        uint64_t left = 1;
+        if (deadline) {
+            uint64_t now = timer_get_ns();
+            left = now < deadline ? schedule_timeout(deadline - now) : 0;
+        } else {
+            schedule();
+        }
+
+        flags = spin_lock_irqsave(&hb->lock);
+        if (list_empty(&q.node)) {
+            break;
+        }
+        if (left == 0) {
+            list_del(&q.node);
+            spin_unlock_irqrestore(&hb->lock, flags);
+            set_current_state(TASK_RUNNING);
+            return -2;
+        }
+    }
+
+    spin_unlock_irqrestore(&hb->lock, flags);
+    set_current_state(TASK_RUNNING);
+    return 0;
+}
+
+uint32_t futex_wake(volatile uint32_t* addr, uint32_t nr) {
+    uint32_t woken = 0;
+
+    futex_bucket_t* hb = futex_bucket(addr);
+    uint64_t flags = spin_lock_irqsave(&hb->lock);
+
+    list_head_t* n = hb->waiters.next;
+    while (woken < nr && n != &hb->waiters) {
+        futex_q_t* q = list_entry(n, futex_q_t, node);
+        n = n->next;
+        if (q->addr != addr) {
+            continue;
+        }
+        list_del(&q->node);
+        wake_up_process(q->task);
+        woken++;
+    }
+
+    spin_unlock_irqrestore(&hb->lock, flags);
+
+    preempt_check_resched();
+    return woken;
+}
@@ -3,10 +3,104 @@
  */
 
 #include <kernel/sched.h>
+#include <kernel/sched_class.h>
+#include <kernel/tick.h>
+#include <arch/interrupts.h>
+
+/******************************************************************************
+ * Idle Scheduling Class
+ * ---------------------
+ * Lowest class, always "queued": it has exactly one task, the CPU's idle
+ * task, which is never on_rq and runs when every other class is empty.
+ *****************************************************************************/
+
+static void init_rq_idle(runqueue_t* rq) {
+    rq_set_queued(rq, &idle_sched_class, true);
+}
+
+static void enqueue_task_idle(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    (void)rq; (void)task; (void)flags;
+}
+
+static void dequeue_task_idle(runqueue_t* rq, task_struct_t* task) {
+    (void)rq; (void)task;
+}
+
+static task_struct_t* pick_next_task_idle(runqueue_t* rq) {
+    return rq->idle;
+}
+
+static void put_prev_task_idle(runqueue_t* rq, task_struct_t* task) {
+    (void)rq; (void)task;
+}
+
+/* Something became runnable without a wakeup kick (e.g. pulled by balancing) */
+static void task_tick_idle(runqueue_t* rq, task_struct_t* curr) {
+    (void)curr;
+    if (rq->nr_running > 0) {
+        set_need_resched(rq);
+    }
+}
+
+static void update_curr_idle(runqueue_t* rq, task_struct_t* curr) {
+    (void)rq; (void)curr;
+}
+
+/* Any runnable task beats the idle task */
+static bool check_preempt_curr_idle(runqueue_t* rq, task_struct_t* next) {
+    (void)rq; (void)next;
+    return true;
+}
+
+const sched_class_t idle_sched_class = {
+    .next               = NULL,
+    .rank               = SCHED_CLASS_IDLE,
+    .init_rq            = init_rq_idle,
+    .enqueue_task       = enqueue_task_idle,
+    .dequeue_task       = dequeue_task_idle,
+    .pick_next_task     = pick_next_task_idle,
+    .put_prev_task      = put_prev_task_idle,
+    .task_tick          = task_tick_idle,
+    .update_curr        = update_curr_idle,
+    .check_preempt_curr = check_preempt_curr_idle,
+};
+
+/******************************************************************************
+ * Idle Loop
+ *****************************************************************************/
+
+/* Sleep until an interrupt arrives. Called with IRQs disabled: ARM64 WFI
+ * still wakes on a pending (masked) IRQ, and x86 STI;HLT cannot lose one
+ * between the two instructions. */
+static inline void arch_cpu_idle(void) {
+#if defined(__aarch64__)
+    __asm__ volatile("wfi" ::: "memory");
+#else
+    __asm__ volatile("sti; hlt; cli" ::: "memory");
+#endif
+}
+
+/* One idle iteration: sleep, with the tick stopped while nothing is runnable */
+void cpu_idle(void) {
+    interrupts_disable();
+
+    /* Checked with IRQs off: a wakeup after this point leaves its IPI pending */
+    if (!scheduler_need_resched()) {
+        tick_nohz_idle_enter();
+        arch_cpu_idle();
+        tick_nohz_idle_exit();
+    }
+
+    /* Take the pending interrupt; the IRQ exit path usually switches tasks */
+    interrupts_enable();
+
+    if (scheduler_need_resched()) {
+        schedule();
+    }
+}
 
 void idle_task_entry(void) {
     while (1) {
-        /* ARM64: Wait for interrupt */
-        __asm__ volatile("wfi");
+        cpu_idle();
     }
 }
@@ -0,0 +1,282 @@
+/**
+ * Mutexes and Priority Inheritance
+ *
+ * The owner word is the whole lock: 0 when free, the owner's task
+ * pointer when held, with MUTEX_HAS_WAITERS set while tasks are queued.
+ * A set waiters bit makes both fast paths fail, so queueing, handing
+ * over and boosting all happen in the slow paths under mutex_pi_lock.
+ * One lock for every mutex keeps a priority chain (owner blocked on a
+ * mutex whose owner is blocked on ...) consistent while it is walked;
+ * it is only taken on contention.
+ *
+ * Lock order: mutex_pi_lock -> task->pi_lock -> rq->lock, IRQs disabled.
+ *
+ * An unlock does not pick the next owner: it clears the owner, leaving
+ * the waiters bit, and wakes the highest-priority waiter, which takes the
+ * mutex when it runs unless another task got there first.
+ */
+
+#include <kernel/mutex.h>
+#include <kernel/atomic.h>
+#include <kernel/console.h>
+#include <kernel/preempt.h>
+#include <kernel/spinlock.h>
+
+/* Give up spinning after this many polls of a running owner */
+#define MUTEX_SPIN_LOOPS        4096
+
+/* Longest owner chain a boost propagates along (also ends lock cycles) */
+#define MUTEX_PI_MAX_DEPTH      16
+
+/* Lives on the waiter's stack while it is queued */
+typedef struct mutex_waiter {
+    list_head_t node;           /* In lock->waiters */
+    task_struct_t* task;
+} mutex_waiter_t;
+
+static spinlock_t mutex_pi_lock = SPINLOCK_INIT;
+
+static inline task_struct_t* mutex_owner(uint64_t val) {
+    return (task_struct_t*)(val & ~MUTEX_HAS_WAITERS);
+}
+
+void mutex_init(mutex_t* lock) {
+    lock->owner = 0;
+    list_init(&lock->waiters);
+    list_init(&lock->held_node);
+}
+
+/******************************************************************************
+ * Priority Inheritance (mutex_pi_lock held)
+ *****************************************************************************/
+
+/* Comparable priority: deadline above all real-time levels, -1 for the
+ * fair policies */
+static int pi_prio(uint8_t policy, uint8_t rt_priority) {
+    if (policy == SCHED_DEADLINE) {
+        return MAX_RT_PRIO;
+    }
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        return rt_priority;
+    }
+    return -1;
+}
+
+/* Highest-priority waiter of lock, oldest first among equals */
+static mutex_waiter_t* top_waiter(mutex_t* lock) {
+    mutex_waiter_t* top = NULL;
+    int top_prio = -2;
+
+    for (list_head_t* n = lock->waiters.next; n != &lock->waiters; n = n->next) {
+        mutex_waiter_t* w = list_entry(n, mutex_waiter_t, node);
+        int prio = pi_prio(w->task->policy, w->task->rt_priority);
+        if (prio > top_prio) {
+            top = w;
+            top_prio = prio;
+        }
+    }
+    return top;
+}
+
+/* Run task at the priority of its most urgent waiter, or at its own
+ * priority if none outranks it */
+static void pi_update(task_struct_t* task) {
+    int base = pi_prio(task->normal_policy, task->normal_rt_priority);
+    int top = base;
+
+    if (task->normal_policy != SCHED_DEADLINE) {
+        for (list_head_t* n = task->pi_held.next; n != &task->pi_held; n = n->next) {
+            mutex_waiter_t* w = top_waiter(list_entry(n, mutex_t, held_node));
+            if (w) {
+                int prio = pi_prio(w->task->policy, w->task->rt_priority);
+                if (prio > top) {
+                    top = prio;
+                }
+            }
+        }
+    }
+
+    if (top > base) {
+        sched_pi_setprio(task, SCHED_FIFO,
+                         top < MAX_RT_PRIO ? (uint8_t)top : MAX_RT_PRIO - 1, true);
+    } else if (task->pi_boosted) {
+        sched_pi_setprio(task, 0, 0, false);
+    }
+}
+
+/* Update task, then every owner down the chain of mutexes it waits on */
+static void pi_chain_adjust(task_struct_t* task) {
+    for (uint32_t depth = 0; task && depth < MUTEX_PI_MAX_DEPTH; depth++) {
+        pi_update(task);
+
+        mutex_t* lock = task->blocked_on;
+        if (!lock) {
+            break;
+        }
+        task = mutex_owner(lock->owner);
+    }
+}
+
+void mutex_pi_adjust(task_struct_t* task) {
+    uint64_t flags = spin_lock_irqsave(&mutex_pi_lock);
+    pi_chain_adjust(task);
+    spin_unlock_irqrestore(&mutex_pi_lock, flags);
+}
+
+/******************************************************************************
+ * Lock / Unlock
+ *****************************************************************************/
+
+/* Spin while the owner runs on another CPU; returns true if the mutex
+ * was taken. Stops once the owner sleeps, waiters queue (they get the
+ * mutex first) or this CPU has something better to run. */
+static bool mutex_spin_on_owner(mutex_t* lock, task_struct_t* cur) {
+    for (uint32_t i = 0; i < MUTEX_SPIN_LOOPS; i++) {
+        uint64_t val = smp_load_acquire(&lock->owner);
+
+        if (val == 0) {
+            if (arch_atomic64_cmpxchg(&lock->owner, 0, (uint64_t)cur) == 0) {
+                return true;
+            }
+            continue;
+        }
+        if ((val & MUTEX_HAS_WAITERS) || !mutex_owner(val)->on_cpu ||
+            scheduler_need_resched()) {
+            return false;
+        }
+        cpu_relax();
+    }
+    return false;
+}
+
+/* Queue, boost the owner chain and sleep until the mutex is taken */
+static void mutex_lock_slowpath(mutex_t* lock, task_struct_t* cur) {
+    mutex_waiter_t waiter = { .task = cur };
+    list_init(&waiter.node);
+
+    uint64_t flags = spin_lock_irqsave(&mutex_pi_lock);
+
+    for (;;) {
+        uint64_t val = lock->owner;
+
+        if (!mutex_owner(val)) {
+            /* Free: take it, keeping the bit if anyone else waits */
+            bool queued = !list_empty(&waiter.node);
+            if (queued) {
+                list_del(&waiter.node);
+            }
+            uint64_t new = (uint64_t)cur | (list_empty(&lock->waiters) ? 0 : MUTEX_HAS_WAITERS);
+            if (arch_atomic64_cmpxchg(&lock->owner, val, new) == val) {
+                break;
+            }
+            if (queued) {
+                list_add(&waiter.node, &lock->waiters);
+            }
+            continue;
+        }
+
+        /* From here the owner can only unlock through the slow path */
+        if (!(val & MUTEX_HAS_WAITERS) &&
+            arch_atomic64_cmpxchg(&lock->owner, val, val | MUTEX_HAS_WAITERS) != val) {
+            continue;
+        }
+
+        task_struct_t* owner = mutex_owner(val);
+        if (list_empty(&waiter.node)) {
+            list_add_tail(&waiter.node, &lock->waiters);
+        }
+        if (list_empty(&lock->held_node)) {
+            list_add_tail(&lock->held_node, &owner->pi_held);
+        }
+        cur->blocked_on = lock;
+        pi_chain_adjust(owner);
+
+        set_current_state(TASK_BLOCKED);
+        spin_unlock_irqrestore(&mutex_pi_lock, flags);
+
+        schedule();
+
+        flags = spin_lock_irqsave(&mutex_pi_lock);
+    }
+
+    cur->blocked_on = NULL;
+    if (!list_empty(&lock->waiters)) {
+        list_add_tail(&lock->held_node, &cur->pi_held);
+        pi_update(cur);
+    }
+
+    spin_unlock_irqrestore(&mutex_pi_lock, flags);
+}
+
+void mutex_lock(mutex_t* lock) {
+    task_struct_t* cur = get_current_task();
+
+    if (arch_atomic64_cmpxchg(&lock->owner, 0, (uint64_t)cur) == 0) {
+        return;
+    }
+    if (mutex_spin_on_owner(lock, cur)) {
+        return;
+    }
+    mutex_lock_slowpath(lock, cur);
+}
+
+bool mutex_trylock(mutex_t* lock) {
+    task_struct_t* cur = get_current_task();
+    uint64_t val = arch_atomic64_cmpxchg(&lock->owner, 0, (uint64_t)cur);
+
+    if (val == 0) {
+        return true;
+    }
+    if (val != MUTEX_HAS_WAITERS) {
+        return false;
+    }
+
+    /* Released but the woken waiter has not taken it yet */
+    uint64_t flags = spin_lock_irqsave(&mutex_pi_lock);
+    bool taken = arch_atomic64_cmpxchg(&lock->owner, MUTEX_HAS_WAITERS,
+                                       (uint64_t)cur | MUTEX_HAS_WAITERS) == MUTEX_HAS_WAITERS;
+    if (taken) {
+        list_add_tail(&lock->held_node, &cur->pi_held);
+        pi_update(cur);
+    }
+    spin_unlock_irqrestore(&mutex_pi_lock, flags);
+    return taken;
+}
+
+/* Release with waiters queued: wake the most urgent one and drop the
+ * boost they gave us */
+static void mutex_unlock_slowpath(mutex_t* lock, task_struct_t* cur) {
+    uint64_t flags = spin_lock_irqsave(&mutex_pi_lock);
+
+    if (mutex_owner(lock->owner) != cur) {
+        spin_unlock_irqrestore(&mutex_pi_lock, flags);
+        console_printf("ERROR: mutex_unlock: %s does not own the mutex\n", cur->name);
+        return;
+    }
+
+    if (!list_empty(&lock->held_node)) {
+        list_del(&lock->held_node);
+    }
+
+    mutex_waiter_t* top = top_waiter(lock);
+    smp_store_release(&lock->owner, top ? MUTEX_HAS_WAITERS : 0);
+    if (top) {
+        wake_up_process(top->task);
+    }
+
+    pi_update(cur);
+
+    spin_unlock_irqrestore(&mutex_pi_lock, flags);
+
+    /* The deboost may have put a queued task ahead of us */
+    preempt_check_resched();
+}
+
+void mutex_unlock(mutex_t* lock) {
+    task_struct_t* cur = get_current_task();
+
+    if (arch_atomic64_cmpxchg(&lock->owner, (uint64_t)cur, 0) == (uint64_t)cur) {
+        return;
+    }
+    mutex_unlock_slowpath(lock, cur);
+}
@@ -1,269 +1,802 @@
 /**
  * Yuheng Scheduler Core Implementation (MVP)
+ *
+ * Policy-independent part: runqueues, wakeups, schedule() and the tick.
+ * Everything policy-specific goes through the task's sched_class (see
+ * kernel/sched_class.h): sched_dl.c, sched_rt.c, sched_fair.c, sched_bg.c
+ * and the idle class in idle.c.
  */
 
 #include <kernel/sched.h>
+#include <kernel/sched_class.h>
 #include <kernel/console.h>
+#include <kernel/fpu.h>
+#include <kernel/futex.h>
 #include <kernel/mm.h>
+#include <kernel/mutex.h>
+#include <kernel/preempt.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
 #include <kernel/string.h>
+#include <kernel/timer_wheel.h>
+#include <arch/interrupts.h>
 
 /* Global scheduler state */
-static task_struct_t* current_task = NULL;
-static task_struct_t* idle_task = NULL;
-static task_struct_t* ready_queue = NULL;
-static bool scheduler_started = false;  /* Track if scheduler has started */
-static uint64_t scheduler_clock = 0;    /* Monotonic tick counter for CFS */
+runqueue_t runqueues[MAX_CPUS];
 task_struct_t task_table[MAX_TASKS];
-uint32_t next_pid = 1;
+
+/* Classes by rank, for picking straight from the lowest bit of queued_mask */
+static const sched_class_t* const sched_classes[SCHED_CLASS_COUNT] = {
+    [SCHED_CLASS_DL]   = &dl_sched_class,
+    [SCHED_CLASS_RT]   = &rt_sched_class,
+    [SCHED_CLASS_FAIR] = &fair_sched_class,
+    [SCHED_CLASS_BG]   = &bg_sched_class,
+    [SCHED_CLASS_IDLE] = &idle_sched_class,
+};
+
+/* context_switch.S hard-codes these offsets */
+_Static_assert(__builtin_offsetof(task_struct_t, cpu_context) == 72,
+               "CPU_CONTEXT_OFFSET in context_switch.S is out of date");
+_Static_assert(__builtin_offsetof(task_struct_t, kernel_stack) == 72 + 104,
+               "kernel_stack offset in context_switch.S is out of date");
+
+/* Ask rq's CPU to reschedule; caller holds rq->lock */
+void resched_curr(runqueue_t* rq) {
+    set_need_resched(rq);
+    if (rq->cpu != smp_processor_id()) {
+        smp_send_reschedule(rq->cpu);
+    }
+}
+
+/* Lock the runqueue a task belongs to (task->cpu only changes under it) */
+runqueue_t* task_rq_lock(task_struct_t* task) {
+    for (;;) {
+        runqueue_t* rq = cpu_rq(task->cpu);
+        spin_lock(&rq->lock);
+        if (rq->cpu == task->cpu) {
+            return rq;
+        }
+        spin_unlock(&rq->lock);
+    }
+}
+
+/* Class implementing a policy */
+static const sched_class_t* policy_class(uint8_t policy) {
+    switch (policy) {
+    case SCHED_DEADLINE:
+        return &dl_sched_class;
+    case SCHED_FIFO:
+    case SCHED_RR:
+        return &rt_sched_class;
+    case SCHED_IDLE:
+        return &bg_sched_class;
+    default:
+        return &fair_sched_class;
+    }
+}
+
+/* Load weight: from priority, or next to nothing for SCHED_IDLE */
+static uint32_t task_weight(task_struct_t* task) {
+    return task->policy == SCHED_IDLE ? WEIGHT_IDLEPRIO : priority_to_weight(task->priority);
+}
 
 /* Get current task */
 task_struct_t* get_current_task(void) {
-    return current_task;
+    /* IRQs off so we cannot migrate between reading the CPU and its curr */
+    uint64_t flags = interrupts_save();
+    task_struct_t* curr = this_rq()->curr;
+    interrupts_restore(flags);
+    return curr;
 }
 
-/* Get scheduler monotonic time (for CFS vruntime calculations) */
+/* Get scheduler monotonic time of this CPU (for CFS vruntime calculations) */
 uint64_t scheduler_get_time(void) {
-    return scheduler_clock;
+    return this_rq()->clock;
+}
+
+/* Charge the running task for time since exec_start */
+static void update_curr(runqueue_t* rq) {
+    task_struct_t* curr = rq->curr;
+    if (curr) {
+        curr->sched_class->update_curr(rq, curr);
+    }
+}
+
+/* Check if current task should be preempted by a newly queued task
+ * A higher class always wins (if next is really queued there); within a
+ * class the class decides */
+bool check_preempt_curr(runqueue_t* rq, task_struct_t* next) {
+    task_struct_t* curr = rq->curr;
+    if (!curr) {
+        return true;
+    }
+    if (next->sched_class == curr->sched_class) {
+        return next->sched_class->check_preempt_curr(rq, next);
+    }
+    return next->sched_class->rank < curr->sched_class->rank &&
+           (rq->queued_mask & (1u << next->sched_class->rank));
 }
 
 /******************************************************************************
- * CFS Helper Functions (Preparation Skeletons)
- * ---------------------------------------------
- * These functions will be fully implemented when CFS is enabled.
- * For now, they serve as extension points for future CFS integration.
+ * Runqueue Management
+ * -------------------
+ * The core keeps the counts and the load; each class keeps its own queue
+ * and its bit in queued_mask, so picking is one bit scan and one call.
  *****************************************************************************/
 
-/* Convert priority (0-9) to CFS weight
- * TODO: Implement proper weight table based on nice values
- * Higher priority → higher weight → more CPU time */
-static uint32_t priority_to_weight(uint8_t priority) {
-    /* Placeholder: return fixed weight for now */
-    (void)priority;  /* Unused for now */
-    return 1024;  /* Default weight */
+/* Initialize a CPU's runqueue */
+static void runqueue_init(runqueue_t* rq, uint32_t cpu) {
+    spin_lock_init(&rq->lock);
+    rq->cpu = cpu;
+    rq->curr = NULL;
+    rq->idle = NULL;
+    rq->clock = 0;
+    rq->queued_mask = 0;
+    rq->load_weight = 0;
+    rq->nr_running = 0;
+    memset(rq->nr_running_class, 0, sizeof(rq->nr_running_class));
+    rq->skip = NULL;
+    clear_need_resched(rq);
+    rq->balance_countdown = SCHED_BALANCE_INTERVAL_TICKS;
+    rq->nohz_idle = false;
+    memset(&rq->stats, 0, sizeof(rq->stats));
+
+    for_each_class(class) {
+        class->init_rq(rq);
+    }
 }
 
-/* Update current task's execution time and virtual runtime
- * TODO: Implement vruntime calculation: vruntime += delta * (NICE_0_WEIGHT / weight)
- * This is the core of CFS fairness */
-static void update_curr_runtime(task_struct_t* task, uint64_t delta) {
-    if (!task || task == idle_task) {
-        return;
-    }
+/* Make a task that is on no runqueue runnable on rq and account its load */
+static void runqueue_enqueue(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    task->state = TASK_READY;
+    task->on_rq = true;
+    task->cpu = rq->cpu;
+    rq->nr_running++;
+    rq->nr_running_class[task->sched_class->rank]++;
+    rq->load_weight += task->weight;
+    task->sched_class->enqueue_task(rq, task, flags);
+}
 
-    /* Accumulate actual runtime */
-    task->sum_exec_runtime += delta;
+/* Dequeue task and drop its load (task may be the running one, outside the queues) */
+static void runqueue_dequeue(runqueue_t* rq, task_struct_t* task) {
+    if (task != rq->curr) {
+        task->sched_class->dequeue_task(rq, task);
+    }
+    if (task->on_rq) {
+        task->on_rq = false;
+        rq->nr_running--;
+        rq->nr_running_class[task->sched_class->rank]--;
+        rq->load_weight -= task->weight;
+    }
+    if (rq->skip == task) {
+        rq->skip = NULL;
+    }
+}
 
-    /* TODO: Update vruntime based on weight
-     * vruntime += delta * (1024 / task->weight)
-     * For now, just increment linearly */
-    task->vruntime += delta;
+/* Pick next task to run: from the highest class with a queued task
+ * (deadline, real-time, fair, and idle, which is always queued) */
+static task_struct_t* runqueue_pick_next(runqueue_t* rq) {
+    uint32_t rank = __builtin_ctz(rq->queued_mask);
+    return sched_classes[rank]->pick_next_task(rq);
 }
 
-/* Check if current task should be preempted by another task
- * TODO: Implement CFS preemption logic based on vruntime delta
- * Preempt if: next->vruntime + threshold < curr->vruntime */
-static bool check_preempt_curr(task_struct_t* curr, task_struct_t* next) {
-    (void)curr;  /* Unused for now */
-    (void)next;  /* Unused for now */
+/* Take the picked task out of its queue; it stays on_rq while running */
+static void set_next_task(runqueue_t* rq, task_struct_t* task) {
+    const sched_class_t* class = task->sched_class;
+
+    class->dequeue_task(rq, task);
+    task->exec_start = rq->clock;
+    task->prev_sum_exec_runtime = task->sum_exec_runtime;
+    if (class->set_next_task) {
+        class->set_next_task(rq, task);
+    }
+}
 
-    /* TODO: Implement vruntime-based preemption
-     * For now, use time slice (existing RR behavior) */
-    return false;
+/* Put a still-runnable task back into its queue. A task preempted
+ * between set_current_state() and schedule() keeps its sleep state: a
+ * wakeup must still see it waiting, and its own schedule() dequeues it. */
+static void put_prev_task(runqueue_t* rq, task_struct_t* task) {
+    task->last_ran = rq->clock;
+    if (task->state == TASK_RUNNING) {
+        task->state = TASK_READY;
+    }
+    task->sched_class->put_prev_task(rq, task);
 }
 
 /******************************************************************************
- * Runqueue Management
- * -------------------
- * Current implementation: Priority-ordered linked list
- * Future: Replace with red-black tree for CFS O(log n) operations
+ * Task Placement
  *****************************************************************************/
 
-/* Initialize runqueue */
-static void runqueue_init(void) {
-    ready_queue = NULL;
+/* Online CPU with the least weighted load (placement of new tasks) */
+static uint32_t find_idlest_cpu(void) {
+    uint32_t best = smp_processor_id();
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (smp_cpu_online(cpu) &&
+            cpu_rq(cpu)->load_weight < cpu_rq(best)->load_weight) {
+            best = cpu;
+        }
+    }
+    return best;
 }
 
-/* Enqueue task (ordered by priority) */
-static void runqueue_enqueue(task_struct_t* task) {
-    task->state = TASK_READY;
+/* Wake-affine: run the wakee on the waker's CPU instead of its previous one?
+ * The waker most likely just produced the data the wakee will consume, so
+ * that cache is the warm one, unless the wakee itself ran on its previous
+ * CPU a moment ago or that CPU is idle and can run it right away. */
+static bool wake_affine(task_struct_t* task, uint32_t this_cpu, uint32_t prev_cpu) {
+    runqueue_t* this_rq = cpu_rq(this_cpu);
+    runqueue_t* prev_rq = cpu_rq(prev_cpu);
 
-    if (ready_queue == NULL || task->priority > ready_queue->priority) {
-        task->next = ready_queue;
-        ready_queue = task;
-    } else {
-        task_struct_t* curr = ready_queue;
-        while (curr->next && curr->next->priority >= task->priority) {
-            curr = curr->next;
-        }
-        task->next = curr->next;
-        curr->next = task;
+    if (prev_rq->nr_running == 0 || task_hot(prev_rq, task)) {
+        return false;
     }
+
+    /* Do not pile onto a CPU noticeably busier than the previous one (25%) */
+    return this_rq->load_weight * 4 <= prev_rq->load_weight * 5;
 }
 
-/* Dequeue task */
-static void runqueue_dequeue(task_struct_t* task) {
-    if (ready_queue == task) {
-        ready_queue = task->next;
-    } else {
-        task_struct_t* curr = ready_queue;
-        while (curr && curr->next != task) {
-            curr = curr->next;
-        }
-        if (curr) {
-            curr->next = task->next;
-        }
+/* Choose a runqueue for a task becoming runnable (caller holds task->pi_lock)
+ * A class may decide itself; otherwise new tasks go to the least loaded
+ * CPU and woken tasks go to the waker's CPU or stay on their previous one
+ * (wake_affine) */
+static runqueue_t* select_task_rq(task_struct_t* task) {
+    uint32_t this_cpu = smp_processor_id();
+    uint32_t prev_cpu = task->cpu;
+
+    if (task->cpu_bound) {
+        return cpu_rq(prev_cpu);
+    }
+    if (task->sched_class->select_task_rq) {
+        return cpu_rq(task->sched_class->select_task_rq(task));
+    }
+    if (task->sum_exec_runtime == 0) {
+        return cpu_rq(find_idlest_cpu());
     }
-    task->next = NULL;
+    if (!smp_cpu_online(prev_cpu)) {
+        return cpu_rq(this_cpu);
+    }
+    /* Still being switched out: only its own runqueue lock orders us after that */
+    if (task->on_cpu || prev_cpu == this_cpu) {
+        return cpu_rq(prev_cpu);
+    }
+    return cpu_rq(wake_affine(task, this_cpu, prev_cpu) ? this_cpu : prev_cpu);
+}
+
+/******************************************************************************
+ * Dynamic Tick
+ * ------------
+ * A CPU may stop its tick only with an empty runqueue. While stopped its
+ * clock does not advance; the skipped ticks are added back on wakeup.
+ *****************************************************************************/
+
+/* Nothing to run and nothing pending: the tick may stop */
+bool sched_can_stop_tick(void) {
+    runqueue_t* rq = this_rq();
+    return rq->nr_running == 0 && !need_resched(rq);
+}
+
+/* Tick stopped: busy CPUs now kick us instead of waiting for our balance */
+void sched_nohz_enter(void) {
+    this_rq()->nohz_idle = true;
 }
 
-/* Pick next task to run */
-static task_struct_t* runqueue_pick_next(void) {
-    if (ready_queue) {
-        return ready_queue;
+/* Tick restarted: account the ticks that were skipped */
+void sched_nohz_exit(uint64_t ticks) {
+    runqueue_t* rq = this_rq();
+
+    spin_lock(&rq->lock);
+    rq->nohz_idle = false;
+    rq->clock += ticks * SCHED_TICK_NS;
+    if (ticks > 0) {
+        rq->balance_countdown = 1;
     }
-    return idle_task;
+    spin_unlock(&rq->lock);
 }
 
 /******************************************************************************
  * Public API for external modules
  *****************************************************************************/
 
-/* Add task to ready queue (public API) */
+/* Enqueue a task that is on no runqueue, placing it in the queue it joins
+ * (caller holds task->pi_lock, IRQs disabled) */
+static void ttwu_activate(task_struct_t* task) {
+    bool woken = task->sum_exec_runtime != 0;
+    uint32_t prev_cpu = task->cpu;
+    runqueue_t* rq = select_task_rq(task);
+
+    spin_lock(&rq->lock);
+
+    if (woken && rq->cpu != prev_cpu) {
+        /* Keep the task's lag relative to the queue it joins */
+        task->vruntime = task->vruntime - cpu_rq(prev_cpu)->min_vruntime +
+                         rq->min_vruntime;
+        task->nr_migrations++;
+        rq->stats.wake_affine++;
+    } else if (woken) {
+        rq->stats.wake_prev++;
+    }
+
+    update_curr(rq);
+    runqueue_enqueue(rq, task, ENQUEUE_WAKEUP | (woken ? 0 : ENQUEUE_INITIAL));
+
+    if (rq->curr && check_preempt_curr(rq, task)) {
+        resched_curr(rq);
+    }
+
+    spin_unlock(&rq->lock);
+}
+
+/* Add task to a ready queue (public API, callable from any CPU) */
 void task_ready(task_struct_t* task) {
-    if (task) {
-        runqueue_enqueue(task);
+    if (!task || task->on_rq) {
+        return;
+    }
+
+    uint64_t flags = interrupts_save();
+    spin_lock(&task->pi_lock);
+
+    if (!task->on_rq) {
+        ttwu_activate(task);
+    }
+
+    spin_unlock(&task->pi_lock);
+    interrupts_restore(flags);
+
+    /* Woke something that should preempt us: switch now, not at the next IRQ */
+    preempt_check_resched();
+}
+
+/* Wake a blocked or sleeping task (callable from any CPU, also from IRQs)
+ * A task that set its state but has not switched out yet is still on its
+ * runqueue: marking it running again makes its schedule() keep it there,
+ * so a wakeup between the condition check and schedule() is not lost */
+bool wake_up_process(task_struct_t* task) {
+    if (!task) {
+        return false;
+    }
+
+    uint64_t flags = interrupts_save();
+    spin_lock(&task->pi_lock);
+
+    bool woken = task->state == TASK_BLOCKED || task->state == TASK_SLEEPING;
+    if (woken) {
+        runqueue_t* rq = task_rq_lock(task);
+        bool queued = task->on_rq;
+        if (queued) {
+            task->state = (rq->curr == task) ? TASK_RUNNING : TASK_READY;
+        }
+        spin_unlock(&rq->lock);
+
+        if (!queued) {
+            ttwu_activate(task);
+        }
     }
+
+    spin_unlock(&task->pi_lock);
+    interrupts_restore(flags);
+
+    preempt_check_resched();
+    return woken;
+}
+
+/* Initialize the scheduling fields of a freshly created task */
+void sched_task_init(task_struct_t* task) {
+    task->sched_class = policy_class(task->policy);
+    task->weight = task_weight(task);
+    task->vruntime = 0;
+    task->exec_start = 0;
+    task->sum_exec_runtime = 0;
+    task->prev_sum_exec_runtime = 0;
+    task->on_rq = false;
+    task->cpu = smp_processor_id();
+    task->on_cpu = false;
+    task->last_ran = 0;
+    task->nr_migrations = 0;
+    task->cpu_bound = false;
+    spin_lock_init(&task->pi_lock);
+    list_init(&task->run_list);
+    task->rt_priority = 0;
+    init_dl_task(task);
+    task->normal_policy = task->policy;
+    task->normal_rt_priority = 0;
+    task->pi_boosted = false;
+    list_init(&task->pi_held);
+    task->blocked_on = NULL;
+}
+
+/* Change a task's scheduling policy, moving it to the new class's queue
+ * (arguments already validated; dl only for SCHED_DEADLINE). A boost
+ * (pi) leaves the task's own policy alone; anything else replaces it and
+ * ends the boost, which the caller re-applies if waiters still need it. */
+static int __sched_setscheduler(task_struct_t* task, uint8_t policy, uint8_t rt_priority,
+                                const sched_dl_attr_t* dl, bool pi) {
+    uint64_t flags = interrupts_save();
+    spin_lock(&task->pi_lock);
+    runqueue_t* rq = task_rq_lock(task);
+
+    /* Admission control: reserve the new bandwidth (or give the old one
+     * back) before anything changes; a task that is not runnable may be
+     * moved to a CPU with room for it */
+    if (dl) {
+        if (dl_bw_reserve(task, (dl->runtime << SCHED_DL_BW_SHIFT) / dl->period) < 0) {
+            spin_unlock(&rq->lock);
+            spin_unlock(&task->pi_lock);
+            interrupts_restore(flags);
+            return -2;
+        }
+    } else if (dl_task(task)) {
+        dl_bw_release(task);
+    }
+
+    const sched_class_t* prev_class = task->sched_class;
+    const sched_class_t* class = policy_class(policy);
+    bool running = (rq->curr == task);
+    bool queued = task->on_rq && !running;
+
+    /* Take the task out of its old class entirely */
+    if (running) {
+        update_curr(rq);
+        prev_class->put_prev_task(rq, task);
+    }
+    if (task->on_rq) {
+        prev_class->dequeue_task(rq, task);
+        rq->nr_running_class[prev_class->rank]--;
+    }
+    if (prev_class->switched_from) {
+        prev_class->switched_from(rq, task);
+    }
+
+    task->policy = policy;
+    task->sched_class = class;
+    task->rt_priority = rt_priority;
+    if (!pi) {
+        task->normal_policy = policy;
+        task->normal_rt_priority = rt_priority;
+        task->pi_boosted = false;
+    }
+    if (task->on_rq) {
+        rq->load_weight -= task->weight;
+    }
+    task->weight = task_weight(task);
+    if (task->on_rq) {
+        rq->load_weight += task->weight;
+    }
+    task->time_slice = DEFAULT_TIMESLICE;
+    if (dl) {
+        dl_set_params(task, dl);
+    }
+
+    /* ...and into the new one */
+    if (task->on_rq) {
+        rq->nr_running_class[class->rank]++;
+    }
+    if (queued) {
+        class->enqueue_task(rq, task, class != prev_class ? ENQUEUE_WAKEUP : 0);
+        if (check_preempt_curr(rq, task)) {
+            resched_curr(rq);
+        }
+    } else if (running) {
+        task->exec_start = rq->clock;
+        if (class->set_next_task) {
+            class->set_next_task(rq, task);
+        }
+
+        /* May have dropped below a queued task */
+        task_struct_t* next = runqueue_pick_next(rq);
+        if (next != rq->idle && check_preempt_curr(rq, next)) {
+            resched_curr(rq);
+        }
+    }
+
+    spin_unlock(&rq->lock);
+    spin_unlock(&task->pi_lock);
+    interrupts_restore(flags);
+    return 0;
+}
+
+/* Change a task's policy to SCHED_FIFO, SCHED_RR, SCHED_NORMAL, SCHED_BATCH
+ * or SCHED_IDLE */
+int sched_setscheduler(task_struct_t* task, uint8_t policy, uint8_t rt_priority) {
+    if (!task || policy == SCHED_DEADLINE || policy > SCHED_IDLE) {
+        return -1;
+    }
+    bool rt = policy == SCHED_FIFO || policy == SCHED_RR;
+    if (rt ? rt_priority >= MAX_RT_PRIO : rt_priority != 0) {
+        return -1;
+    }
+    if (__sched_setscheduler(task, policy, rt_priority, NULL, false) < 0) {
+        return -1;
+    }
+    mutex_pi_adjust(task);
+    return 0;
+}
+
+void sched_pi_setprio(task_struct_t* task, uint8_t policy, uint8_t rt_priority, bool boosted) {
+    if (!boosted) {
+        policy = task->normal_policy;
+        rt_priority = task->normal_rt_priority;
+    }
+    if (task->policy == policy && task->rt_priority == rt_priority) {
+        task->pi_boosted = boosted;
+        return;
+    }
+    __sched_setscheduler(task, policy, rt_priority, NULL, true);
+    task->pi_boosted = boosted;
+}
+
+/* Bind a not yet runnable task to one CPU */
+int task_bind_cpu(task_struct_t* task, uint32_t cpu) {
+    if (!task || !smp_cpu_online(cpu)) {
+        return -1;
+    }
+
+    uint64_t flags = interrupts_save();
+    spin_lock(&task->pi_lock);
+    runqueue_t* rq = task_rq_lock(task);
+
+    int ret = -1;
+    if (!task->on_rq && task->sum_exec_runtime == 0) {
+        task->cpu = cpu;    /* Not on any runqueue: nothing else to move */
+        task->cpu_bound = true;
+        ret = 0;
+    }
+
+    spin_unlock(&rq->lock);
+    spin_unlock(&task->pi_lock);
+    interrupts_restore(flags);
+    return ret;
+}
+
+/* Make a task SCHED_DEADLINE (or change its parameters) */
+int sched_setscheduler_dl(task_struct_t* task, uint64_t runtime_ns,
+                          uint64_t deadline_ns, uint64_t period_ns) {
+    if (!task || runtime_ns < SCHED_DL_MIN_RUNTIME_NS || runtime_ns > deadline_ns ||
+        deadline_ns > period_ns || period_ns > SCHED_DL_MAX_PERIOD_NS) {
+        return -1;
+    }
+
+    sched_dl_attr_t attr = { runtime_ns, deadline_ns, period_ns };
+    int ret = __sched_setscheduler(task, SCHED_DEADLINE, 0, &attr, false);
+    if (ret == 0) {
+        mutex_pi_adjust(task);
+    }
+    return ret;
 }
 
 /* Pick next task (public API for external use if needed) */
 task_struct_t* pick_next_task(void) {
-    return runqueue_pick_next();
+    return runqueue_pick_next(this_rq());
 }
 
-/* Scheduler tick - called every timer interrupt */
+/* True if the current task should be switched out at the next opportunity */
+bool scheduler_need_resched(void) {
+    return need_resched(this_rq());
+}
+
+/* Scheduler tick - called every timer interrupt on each CPU (IRQs off) */
 void scheduler_tick(void) {
-    scheduler_clock++;  /* Increment monotonic scheduler clock */
+    runqueue_t* rq = this_rq();
+    spin_lock(&rq->lock);
 
-    if (current_task == NULL || current_task == idle_task) {
-        return;
-    }
+    rq->clock += SCHED_TICK_NS;  /* Advance this CPU's scheduler clock */
 
-    current_task->total_runtime++;
+    task_struct_t* curr = rq->curr;
+    bool idle = rq_idle_queued(rq) &&
+                (curr == NULL || curr->sched_class->rank >= SCHED_CLASS_BG);
+
+    if (curr) {
+        if (curr != rq->idle) {
+            curr->total_runtime++;
+        }
+        update_curr(rq);
+        curr->sched_class->task_tick(rq, curr);
+    }
 
-    if (current_task->policy == SCHED_RR) {
-        if (current_task->time_slice > 0) {
-            current_task->time_slice--;
+    /* Periodic load balancing: every tick while idle, less often when busy */
+    if (--rq->balance_countdown == 0) {
+        rq->balance_countdown = idle ? 1 : SCHED_BALANCE_INTERVAL_TICKS;
+        rq->stats.balance_runs++;
+        load_balance(rq, idle);
+        if (!idle && rq->nr_running >= 2) {
+            nohz_balance_kick(rq);
         }
     }
+
+    spin_unlock(&rq->lock);
+
+    /* Coarse timeouts; callbacks may wake tasks, so outside the rq lock */
+    timer_wheel_run();
 }
 
 /* External: arch-specific context switch */
 extern void switch_to(task_struct_t* prev, task_struct_t* next);
 
-/******************************************************************************
- * First Task Scheduling
- * ---------------------
- * Special case: First task switch doesn't save previous context
- * (there is no previous task), so we directly restore and jump.
- *****************************************************************************/
-static void schedule_first_task(void) {
-    task_struct_t* next = runqueue_pick_next();
-    if (!next || next == idle_task) {
-        /* Edge case: No tasks ready. Just mark scheduler as started and return.
-         * Idle task will run on next schedule() call. */
-        scheduler_started = true;
-        return;
-    }
+/* Runs on the next task's stack right after switch_to(): prev is now fully
+ * off this CPU and may be woken elsewhere or migrated, or reaped if it exited */
+static void finish_task_switch(runqueue_t* rq) {
+    task_struct_t* prev = rq->prev;
 
-    scheduler_started = true;
-    next->state = TASK_RUNNING;
-    next->switches++;
-    current_task = next;
-    runqueue_dequeue(next);
-
-    console_printf("[Scheduler] First switch to task %s (PID=%u)\n",
-                   next->name, next->pid);
-
-    /* Restore registers from next->cpu_context and jump to task */
-    __asm__ volatile(
-        "mov x8, %0\n"               /* x8 = &next->cpu_context */
-        "ldp x19, x20, [x8], #16\n"
-        "ldp x21, x22, [x8], #16\n"
-        "ldp x23, x24, [x8], #16\n"
-        "ldp x25, x26, [x8], #16\n"
-        "ldp x27, x28, [x8], #16\n"
-        "ldp x29, x30, [x8], #16\n"  /* Restore FP and LR */
-        "ldr x9, [x8]\n"             /* Load SP */
-        "mov sp, x9\n"
-        "ret\n"                      /* Jump to task entry (in x30/LR) */
-        :: "r"(&next->cpu_context)
-        : "memory"
-    );
-    __builtin_unreachable();
-}
-
-/* Schedule: select and switch to next task */
-void schedule(void) {
-    if (current_task == NULL) {
-        return;
-    }
+    __atomic_store_n(&prev->on_cpu, false, __ATOMIC_RELEASE);
+    spin_unlock(&rq->lock);
 
-    /* First time scheduling: jump directly to first task without saving context */
-    if (!scheduler_started) {
-        schedule_first_task();
-        /* NOTREACHED */
+    if (prev->state == TASK_ZOMBIE) {
+        task_reap(prev);
     }
+}
 
-    task_struct_t* prev = current_task;
-    task_struct_t* next = runqueue_pick_next();
+/* Called by a new task before its entry function (see ret_from_fork):
+ * finishes the switch that started it */
+void schedule_tail(void) {
+    finish_task_switch(this_rq());
+    interrupts_enable();
+}
 
-    if (prev == next) {
+/* Select and switch to the next task
+ * preempt: prev was interrupted, so it stays runnable whatever its state
+ * (it may be between setting its state and calling schedule()) */
+static void __schedule(bool preempt) {
+    uint64_t flags = interrupts_save();
+    runqueue_t* rq = this_rq();
+    spin_lock(&rq->lock);
+
+    task_struct_t* prev = rq->curr;
+    if (prev == NULL) {
+        spin_unlock(&rq->lock);
+        interrupts_restore(flags);
         return;
     }
 
-    /* Save prev state if still ready */
-    if (prev->state == TASK_RUNNING) {
-        prev->state = TASK_READY;
-        if (prev != idle_task && prev->time_slice > 0) {
-            runqueue_enqueue(prev);
-        } else if (prev != idle_task) {
-            prev->time_slice = DEFAULT_TIMESLICE;
-            runqueue_enqueue(prev);
+    update_curr(rq);
+
+    /* Requeue prev if still runnable; otherwise drop it from the runqueue */
+    if (prev != rq->idle) {
+        if (prev->state == TASK_RUNNING || preempt) {
+            put_prev_task(rq, prev);
+        } else if (prev->on_rq) {
+            prev->last_ran = rq->clock;
+            runqueue_dequeue(rq, prev);
         }
     }
 
-    /* Dequeue next from ready queue */
-    if (next != idle_task) {
-        runqueue_dequeue(next);
+    /* About to go idle (or to background work): try to pull work from a
+     * busier CPU first. prev is requeued or dequeued but still rq->curr;
+     * load_balance() keeps rq->lock held throughout, so nobody else sees
+     * that state (and can_migrate_task() refuses on_cpu tasks anyway). */
+    if (rq_idle_queued(rq)) {
+        rq->stats.idle_balance_runs++;
+        load_balance(rq, true);
     }
-    next->state = TASK_RUNNING;
-    next->switches++;
 
-    current_task = next;
+    task_struct_t* next = runqueue_pick_next(rq);
+    clear_need_resched(rq);
+    rq->skip = NULL;
+    set_next_task(rq, next);
+    if (next->state == TASK_READY) {
+        next->state = TASK_RUNNING;     /* Not a preempted sleeper, see put_prev_task() */
+    }
 
-    /* Perform context switch */
+    if (prev == next) {
+        spin_unlock(&rq->lock);
+        interrupts_restore(flags);
+        return;
+    }
+    next->switches++;
+    next->on_cpu = true;
+    fpu_switch(prev, next);
+    rq->curr = next;
+    rq->prev = prev;
+
+    /* Perform context switch; rq->lock is released by whoever runs next
+     * (the code below, or schedule_tail() for a new task) */
     switch_to(prev, next);
+
+    /* prev resumes here, possibly on another CPU */
+    finish_task_switch(this_rq());
+    interrupts_restore(flags);
 }
 
-/* Task yield */
+/* Schedule: switch to the next task; a task whose state is no longer
+ * TASK_RUNNING leaves the runqueue until it is woken */
+void schedule(void) {
+    __schedule(false);
+}
+
+/* Reschedule on the way out of an interrupt (IRQs disabled, after EOI,
+ * preempt_count zero); called from the arch IRQ exit path */
+void preempt_schedule_irq(void) {
+    do {
+        __schedule(true);
+    } while (need_resched(this_rq()));
+}
+
+/* Preemption point outside interrupts (preempt_enable(), wakeups) */
+void preempt_schedule(void) {
+    if (preempt_count() != 0 || !interrupts_enabled()) {
+        return;
+    }
+    __schedule(true);
+}
+
+/* Task yield: let the next-leftmost task run even if we have the smallest vruntime
+ * (a real-time task goes to the tail of its priority list instead; a deadline
+ * task gives up the rest of its budget until its next period) */
 void task_yield(void) {
+    uint64_t flags = interrupts_save();
+    runqueue_t* rq = this_rq();
+    if (rq->curr && rq->curr != rq->idle) {
+        rq->skip = rq->curr;
+    }
+    interrupts_restore(flags);
     schedule();
 }
 
-/* Initialize scheduler */
+/* Set up the calling CPU's runqueue with its boot context as the idle task */
+void scheduler_init_cpu(void) {
+    runqueue_t* rq = this_rq();
+
+    rq->idle = task_create_idle();
+    rq->idle->sched_class = &idle_sched_class;
+    rq->idle->cpu = rq->cpu;
+    rq->idle->on_cpu = true;
+    rq->curr = rq->idle;
+}
+
+/* Initialize scheduler (boot CPU, before other CPUs are started) */
 void scheduler_init(void) {
     console_printf("  [*] Initializing Yuheng scheduler...\n");
 
-    memset(task_table, 0, sizeof(task_table));
+    task_table_init();
+    futex_init();
 
-    next_pid = 1;
-    runqueue_init();
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        runqueue_init(cpu_rq(cpu), cpu);
+    }
 
-    /* Create idle task - will be implemented in idle.c */
-    extern void idle_task_entry(void);
-    idle_task = task_create("idle", idle_task_entry, 0, 4096);
-    idle_task->pid = 0;
-    current_task = idle_task;
+    /* kernel_main's context becomes CPU 0's idle task */
+    scheduler_init_cpu();
 
     console_printf("      Yuheng scheduler initialized\n");
 }
+
+/* Copy one CPU's load balancing counters */
+void sched_get_balance_stats(uint32_t cpu, sched_balance_stats_t* stats) {
+    if (cpu >= MAX_CPUS) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    runqueue_t* rq = cpu_rq(cpu);
+    uint64_t flags = spin_lock_irqsave(&rq->lock);
+    *stats = rq->stats;
+    spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+/* Print load balancing counters of all online CPUs */
+void sched_print_balance_stats(void) {
+    console_printf("Load balance statistics:\n");
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!smp_cpu_online(cpu)) {
+            continue;
+        }
+
+        sched_balance_stats_t st;
+        sched_get_balance_stats(cpu, &st);
+        console_printf("  CPU%u: nr=%u load=%llu balance=%llu idle_balance=%llu "
+                       "steal=%llu/%llu migrate_in=%llu migrate_out=%llu "
+                       "wake_affine=%llu wake_prev=%llu nohz_kicks=%llu\n",
+                       cpu, cpu_rq(cpu)->nr_running, cpu_rq(cpu)->load_weight,
+                       st.balance_runs, st.idle_balance_runs,
+                       st.steal_success, st.steal_attempts,
+                       st.migrations_in, st.migrations_out,
+                       st.wake_affine, st.wake_prev, st.nohz_kicks);
+    }
+}
+
+/* Contention on the runqueue locks (SPINLOCK_STATS builds) */
+void sched_print_lock_stats(void) {
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (smp_cpu_online(cpu)) {
+            spin_lock_stats_report("rq", cpu, &cpu_rq(cpu)->lock);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * Background Scheduling Class (SCHED_IDLE)
+ *
+ * Ranked just above the idle task: background tasks run only when no
+ * deadline, real-time or CFS task is runnable on the CPU, and any of
+ * those preempts them on wakeup. Among themselves they take turns in
+ * DEFAULT_TIMESLICE slices from a single FIFO list (O(1) throughout).
+ */
+
+#include <kernel/sched_class.h>
+
+static void init_rq_bg(runqueue_t* rq) {
+    list_init(&rq->bg.queue);
+}
+
+/* Queue at the tail, or at the head if it was preempted mid-slice */
+static void enqueue_task_bg(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    if (flags & ENQUEUE_HEAD) {
+        list_add(&task->run_list, &rq->bg.queue);
+    } else {
+        list_add_tail(&task->run_list, &rq->bg.queue);
+    }
+    rq_set_queued(rq, &bg_sched_class, true);
+}
+
+static void dequeue_task_bg(runqueue_t* rq, task_struct_t* task) {
+    list_del(&task->run_list);
+    rq_set_queued(rq, &bg_sched_class, !list_empty(&rq->bg.queue));
+}
+
+static task_struct_t* pick_next_task_bg(runqueue_t* rq) {
+    return list_first_entry(&rq->bg.queue, task_struct_t, run_list);
+}
+
+/* Back to the head if preempted, to the tail once the slice is used up */
+static void put_prev_task_bg(runqueue_t* rq, task_struct_t* task) {
+    enqueue_task_bg(rq, task, slice_requeue_flags(rq, task, true));
+}
+
+/* End of the slice: let the next background task have a turn */
+static void task_tick_bg(runqueue_t* rq, task_struct_t* curr) {
+    slice_tick(rq, curr, &rq->bg.queue);
+}
+
+/* Background tasks never preempt each other */
+static bool check_preempt_curr_bg(runqueue_t* rq, task_struct_t* next) {
+    (void)rq; (void)next;
+    return false;
+}
+
+const sched_class_t bg_sched_class = {
+    .next               = &idle_sched_class,
+    .rank               = SCHED_CLASS_BG,
+    .init_rq            = init_rq_bg,
+    .enqueue_task       = enqueue_task_bg,
+    .dequeue_task       = dequeue_task_bg,
+    .pick_next_task     = pick_next_task_bg,
+    .put_prev_task      = put_prev_task_bg,
+    .task_tick          = task_tick_bg,
+    .update_curr        = update_curr_common,
+    .check_preempt_curr = check_preempt_curr_bg,
+};
@@ -0,0 +1,347 @@
+/**
+ * Deadline Scheduling Class (SCHED_DEADLINE)
+ *
+ * SCHED_DEADLINE tasks run before all others, earliest absolute deadline
+ * first. Each is a constant bandwidth server: it may use dl_runtime of
+ * every dl_period, charged on the precise clock, and is throttled until
+ * its next period once that runs out. A task waking up with more budget
+ * left than its bandwidth allows before its deadline gets a fresh
+ * deadline instead, so sleeping cannot be used to steal time. Admission
+ * keeps the bandwidth reserved on each CPU under SCHED_DL_BW_LIMIT; with
+ * tasks kept on their CPU, that is enough for EDF to meet every deadline.
+ */
+
+#include <kernel/sched_class.h>
+#include <kernel/console.h>
+
+extern task_struct_t task_table[MAX_TASKS];
+
+/* Bandwidth reserved on each CPU (admission control) */
+static spinlock_t dl_bw_lock = SPINLOCK_INIT;
+static uint64_t dl_cpu_bw[MAX_CPUS];
+
+static inline bool dl_time_before(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b) < 0;
+}
+
+/* Deadline tree ordering: earlier absolute deadline first */
+static bool deadline_less(const rb_node_t* a, const rb_node_t* b) {
+    return dl_time_before(rb_entry(a, task_struct_t, run_node)->deadline,
+                          rb_entry(b, task_struct_t, run_node)->deadline);
+}
+
+/* Start a new instance: full budget, deadline relative to now */
+static void dl_new_instance(task_struct_t* task, uint64_t now) {
+    task->deadline = now + task->dl_deadline;
+    task->runtime = (int64_t)task->dl_runtime;
+    task->dl_missed = false;
+}
+
+/* CBS wakeup rule: keep the current deadline and budget only if using the
+ * rest of the budget before that deadline stays within the bandwidth,
+ * i.e. runtime / (deadline - now) <= dl_runtime / dl_period */
+static void dl_task_wakeup(task_struct_t* task, uint64_t now) {
+    if (task->dl_throttled) {
+        return;     /* dl_timer replenishes it */
+    }
+    if (task->runtime <= 0 || !dl_time_before(now, task->deadline) ||
+        (unsigned __int128)(uint64_t)task->runtime * task->dl_period >
+        (unsigned __int128)(task->deadline - now) * task->dl_runtime) {
+        dl_new_instance(task, now);
+    }
+}
+
+/* Next period: postpone the deadline until the budget is positive again */
+static void dl_replenish(task_struct_t* task, uint64_t now) {
+    while (task->runtime <= 0) {
+        task->deadline += task->dl_period;
+        task->runtime += (int64_t)task->dl_runtime;
+    }
+    if (dl_time_before(task->deadline, now)) {
+        dl_new_instance(task, now);     /* Far behind: restart from now */
+    }
+    task->dl_missed = false;
+}
+
+/* Count (and report) a task still runnable with budget left past its deadline */
+static void dl_check_miss(runqueue_t* rq, task_struct_t* task, uint64_t now) {
+    if (task->dl_missed || !dl_time_before(task->deadline, now)) {
+        return;
+    }
+
+    task->dl_missed = true;
+    task->dl_misses++;
+    rq->dl.nr_misses++;
+
+    /* Report the 1st, 2nd, 4th, 8th... miss of each task */
+    if ((task->dl_misses & (task->dl_misses - 1)) == 0) {
+        console_printf("[sched] CPU%u: %s (PID %u) missed its deadline by %llu us (%llu misses)\n",
+                       rq->cpu, task->name, task->pid,
+                       (now - task->deadline) / NSEC_PER_USEC, task->dl_misses);
+    }
+}
+
+/* Out of budget: off the tree until the next period starts */
+static void dl_throttle(task_struct_t* task) {
+    task->dl_throttled = true;
+    hrtimer_start(&task->dl_timer, task->deadline - task->dl_deadline + task->dl_period,
+                  HRTIMER_MODE_ABS);
+}
+
+/* Replenishment timer: the throttled task's next period has started */
+static hrtimer_restart_t dl_timer_fn(hrtimer_t* timer) {
+    task_struct_t* task = timer->data;
+    runqueue_t* rq = task_rq_lock(task);
+
+    if (task->dl_throttled && dl_task(task)) {
+        task->dl_throttled = false;
+        dl_replenish(task, timer_get_ns());
+
+        /* Still running (not switched out yet) tasks just carry on */
+        if (task->on_rq && rq->curr != task) {
+            dl_sched_class.enqueue_task(rq, task, 0);
+            if (check_preempt_curr(rq, task)) {
+                resched_curr(rq);
+            }
+        }
+    }
+
+    spin_unlock(&rq->lock);
+    return HRTIMER_NORESTART;
+}
+
+/* Charge the running task and throttle it once its budget is used up */
+static void update_curr_dl(runqueue_t* rq, task_struct_t* curr) {
+    uint64_t now = timer_get_ns();
+    uint64_t delta = now - curr->dl_exec_start;
+
+    curr->exec_start = rq->clock;
+    curr->dl_exec_start = now;
+    curr->sum_exec_runtime += delta;
+    if (curr->dl_throttled) {
+        return;
+    }
+
+    curr->runtime -= (int64_t)delta;
+    if (curr->runtime > 0) {
+        dl_check_miss(rq, curr, now);
+        return;
+    }
+
+    curr->dl_overruns++;
+    rq->dl.nr_throttled++;
+    dl_throttle(curr);
+    resched_curr(rq);
+}
+
+/* Budget timer: enforce the running task's budget between ticks */
+static hrtimer_restart_t dl_budget_timer_fn(hrtimer_t* timer) {
+    runqueue_t* rq = timer->data;
+    hrtimer_restart_t restart = HRTIMER_NORESTART;
+
+    spin_lock(&rq->lock);
+    task_struct_t* curr = rq->curr;
+    if (curr && dl_task(curr) && !curr->dl_throttled) {
+        update_curr_dl(rq, curr);
+        if (!curr->dl_throttled) {
+            /* Fired a little early: come back when the rest is used */
+            timer->expires = curr->dl_exec_start + (uint64_t)curr->runtime;
+            restart = HRTIMER_RESTART;
+        }
+    }
+    spin_unlock(&rq->lock);
+
+    return restart;
+}
+
+static void init_rq_dl(runqueue_t* rq) {
+    rq->dl.root = (rb_root_t)RB_ROOT_INIT;
+    rq->dl.nr_misses = 0;
+    rq->dl.nr_throttled = 0;
+    hrtimer_init(&rq->dl.budget_timer, dl_budget_timer_fn, rq);
+}
+
+/* A throttled task stays out of the tree (dl_timer puts it back) */
+static void enqueue_task_dl(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    if (flags & ENQUEUE_WAKEUP) {
+        dl_task_wakeup(task, timer_get_ns());
+    }
+    if (!task->dl_throttled) {
+        rb_insert(&rq->dl.root, &task->run_node, deadline_less);
+        rq_set_queued(rq, &dl_sched_class, true);
+    }
+}
+
+static void dequeue_task_dl(runqueue_t* rq, task_struct_t* task) {
+    if (!task->dl_throttled) {
+        rb_delete(&rq->dl.root, &task->run_node);
+        rq_set_queued(rq, &dl_sched_class, rb_first_cached(&rq->dl.root) != NULL);
+    }
+}
+
+static task_struct_t* pick_next_task_dl(runqueue_t* rq) {
+    return rb_task(rb_first_cached(&rq->dl.root));
+}
+
+/* Throttle right when the budget runs out, not at the next tick */
+static void set_next_task_dl(runqueue_t* rq, task_struct_t* task) {
+    task->dl_exec_start = timer_get_ns();
+    if (rq->cpu == smp_processor_id()) {
+        hrtimer_start(&rq->dl.budget_timer, task->dl_exec_start + (uint64_t)task->runtime,
+                      HRTIMER_MODE_ABS);
+    }
+}
+
+/* A task that yielded is done with this instance and sleeps until its
+ * next period */
+static void put_prev_task_dl(runqueue_t* rq, task_struct_t* task) {
+    hrtimer_try_to_cancel(&rq->dl.budget_timer);
+    if (rq->skip == task && !task->dl_throttled) {
+        task->runtime = 0;
+        dl_throttle(task);
+    }
+    enqueue_task_dl(rq, task, 0);
+}
+
+/* A task waiting past its deadline has missed it as well */
+static void task_tick_dl(runqueue_t* rq, task_struct_t* curr) {
+    (void)curr;
+    task_struct_t* first = pick_next_task_dl(rq);
+    if (first) {
+        dl_check_miss(rq, first, timer_get_ns());
+    }
+}
+
+static bool check_preempt_curr_dl(runqueue_t* rq, task_struct_t* next) {
+    task_struct_t* curr = rq->curr;
+    if (next->dl_throttled) {
+        return false;
+    }
+    return curr->dl_throttled || dl_time_before(next->deadline, curr->deadline);
+}
+
+/* Deadline tasks stay on the CPU holding their bandwidth */
+static uint32_t select_task_rq_dl(task_struct_t* task) {
+    return task->cpu;
+}
+
+/* Forget the current instance (a throttled task is not queued anywhere) */
+static void switched_from_dl(runqueue_t* rq, task_struct_t* task) {
+    (void)rq;
+    if (task->dl_throttled) {
+        task->dl_throttled = false;
+        hrtimer_try_to_cancel(&task->dl_timer);
+    }
+}
+
+const sched_class_t dl_sched_class = {
+    .next               = &rt_sched_class,
+    .rank               = SCHED_CLASS_DL,
+    .init_rq            = init_rq_dl,
+    .enqueue_task       = enqueue_task_dl,
+    .dequeue_task       = dequeue_task_dl,
+    .pick_next_task     = pick_next_task_dl,
+    .set_next_task      = set_next_task_dl,
+    .put_prev_task      = put_prev_task_dl,
+    .task_tick          = task_tick_dl,
+    .update_curr        = update_curr_dl,
+    .check_preempt_curr = check_preempt_curr_dl,
+    .select_task_rq     = select_task_rq_dl,
+    .switched_from      = switched_from_dl,
+};
+
+/* Initialize the deadline fields of a new task */
+void init_dl_task(task_struct_t* task) {
+    task->dl_runtime = 0;
+    task->dl_deadline = 0;
+    task->dl_period = 0;
+    task->dl_bw = 0;
+    task->deadline = 0;
+    task->runtime = 0;
+    task->dl_exec_start = 0;
+    task->dl_throttled = false;
+    task->dl_missed = false;
+    task->dl_misses = 0;
+    task->dl_overruns = 0;
+    hrtimer_init(&task->dl_timer, dl_timer_fn, task);
+}
+
+/* Set new parameters and start a fresh instance */
+void dl_set_params(task_struct_t* task, const sched_dl_attr_t* attr) {
+    task->dl_runtime = attr->runtime;
+    task->dl_deadline = attr->deadline;
+    task->dl_period = attr->period;
+    dl_new_instance(task, timer_get_ns());
+}
+
+/* Reserve new_bw for task on a CPU: its own, or, if it is not runnable,
+ * whichever has the least bandwidth reserved (the old reservation is
+ * released). Caller holds task->pi_lock and its runqueue lock.
+ * Returns the CPU or -1 */
+int dl_bw_reserve(task_struct_t* task, uint64_t new_bw) {
+    uint32_t old_cpu = task->cpu;
+    uint64_t old_bw = dl_task(task) ? task->dl_bw : 0;
+    bool movable = !task->on_rq && !task->on_cpu && !task->cpu_bound;
+    int best = -1;
+    uint64_t best_bw = 0;
+
+    spin_lock(&dl_bw_lock);
+
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        uint32_t cpu = (old_cpu + i) % MAX_CPUS;    /* Ties keep the old CPU */
+        if (cpu != old_cpu && (!movable || !smp_cpu_online(cpu))) {
+            continue;
+        }
+
+        uint64_t bw = dl_cpu_bw[cpu] - (cpu == old_cpu ? old_bw : 0);
+        if (bw + new_bw <= SCHED_DL_BW_LIMIT && (best < 0 || bw < best_bw)) {
+            best = (int)cpu;
+            best_bw = bw;
+        }
+    }
+
+    if (best >= 0) {
+        dl_cpu_bw[old_cpu] -= old_bw;
+        dl_cpu_bw[best] += new_bw;
+        task->cpu = (uint32_t)best;
+        task->dl_bw = new_bw;
+    }
+
+    spin_unlock(&dl_bw_lock);
+    return best;
+}
+
+/* Give back a deadline task's reservation */
+void dl_bw_release(task_struct_t* task) {
+    spin_lock(&dl_bw_lock);
+    dl_cpu_bw[task->cpu] -= task->dl_bw;
+    task->dl_bw = 0;
+    spin_unlock(&dl_bw_lock);
+}
+
+/* Print reserved deadline bandwidth per CPU and misses per deadline task */
+void sched_print_dl_stats(void) {
+    console_printf("Deadline statistics:\n");
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!smp_cpu_online(cpu)) {
+            continue;
+        }
+
+        runqueue_t* rq = cpu_rq(cpu);
+        console_printf("  CPU%u: reserved=%llu%% nr=%u misses=%llu throttled=%llu\n",
+                       cpu, (dl_cpu_bw[cpu] * 100) >> SCHED_DL_BW_SHIFT,
+                       rq->nr_running_class[SCHED_CLASS_DL], rq->dl.nr_misses,
+                       rq->dl.nr_throttled);
+    }
+
+    for (uint32_t i = 0; i < MAX_TASKS; i++) {
+        task_struct_t* task = &task_table[i];
+        if (task->state == TASK_ZOMBIE || task->pid == 0 || !dl_task(task)) {
+            continue;
+        }
+        console_printf("  %s (PID %u) CPU%u: %llu/%llu us, misses=%llu overruns=%llu\n",
+                       task->name, task->pid, task->cpu,
+                       task->dl_runtime / NSEC_PER_USEC, task->dl_period / NSEC_PER_USEC,
+                       task->dl_misses, task->dl_overruns);
+    }
+}
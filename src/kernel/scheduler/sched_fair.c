@@ -0,0 +1,382 @@
+/**
+ * Fair Scheduling Class (SCHED_NORMAL, CFS)
+ *
+ * Red-black tree keyed by vruntime with cached leftmost node:
+ * enqueue/dequeue O(log n), pick_next O(1). Also balances CFS load
+ * between CPUs, and hands background tasks to CPUs with nothing to run
+ * (the other classes never migrate).
+ */
+
+#include <kernel/sched_class.h>
+
+/******************************************************************************
+ * CFS Helper Functions
+ * --------------------
+ * Weights follow the Linux nice table: each priority step is two nice
+ * levels (~1.56x CPU share). Priority 5 is nice 0 (weight 1024).
+ *****************************************************************************/
+
+/* Priority (0-9) to weight: nice +10 .. -8 in steps of 2 */
+static const uint32_t sched_prio_to_weight[10] = {
+    /* 0 */  110,  172,  272,  423,  655,
+    /* 5 */ 1024, 1586, 2501, 3906, 6100,
+};
+
+/* 2^32 / weight, so vruntime scaling is a multiply and shift instead of a divide */
+static const uint32_t sched_prio_to_wmult[10] = {
+    /* 0 */ 39045157, 24970740, 15790321,  9975065,  6324322,
+    /* 5 */  4194304,  2708050,  1717300,  1099582,   704093,
+};
+
+/* Convert priority (0-9) to CFS weight
+ * Higher priority → higher weight → more CPU time */
+uint32_t priority_to_weight(uint8_t priority) {
+    if (priority > 9) {
+        priority = 9;
+    }
+    return sched_prio_to_weight[priority];
+}
+
+/* Scale a runtime delta by NICE_0_WEIGHT / task weight */
+static uint64_t calc_delta_fair(uint64_t delta, task_struct_t* task) {
+    if (task->weight == NICE_0_WEIGHT) {
+        return delta;
+    }
+    uint8_t prio = task->priority > 9 ? 9 : task->priority;
+    /* delta * 1024 * 2^32 / weight >> 32 == (delta * wmult) >> 22 */
+    return (delta * sched_prio_to_wmult[prio]) >> 22;
+}
+
+/* Wrap-safe vruntime comparison */
+static inline int64_t vruntime_delta(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b);
+}
+
+/* Timeline ordering: smaller vruntime first */
+static bool vruntime_less(const rb_node_t* a, const rb_node_t* b) {
+    return vruntime_delta(rb_entry(a, task_struct_t, run_node)->vruntime,
+                          rb_entry(b, task_struct_t, run_node)->vruntime) < 0;
+}
+
+/* Advance min_vruntime towards min(curr, leftmost); never goes backwards */
+static void update_min_vruntime(runqueue_t* rq) {
+    task_struct_t* curr = rq->curr;
+    task_struct_t* first = rb_task(rb_first_cached(&rq->tasks_timeline));
+    uint64_t vruntime = rq->min_vruntime;
+    bool have_curr = curr && curr->on_rq && fair_task(curr);
+
+    if (have_curr) {
+        vruntime = curr->vruntime;
+    }
+    if (first) {
+        if (!have_curr || vruntime_delta(first->vruntime, vruntime) < 0) {
+            vruntime = first->vruntime;
+        }
+    }
+
+    if (vruntime_delta(vruntime, rq->min_vruntime) > 0) {
+        rq->min_vruntime = vruntime;
+    }
+}
+
+/* Charge the running task: vruntime += delta * (NICE_0_WEIGHT / weight) */
+static void update_curr_fair(runqueue_t* rq, task_struct_t* curr) {
+    uint64_t now = rq->clock;
+    uint64_t delta = now - curr->exec_start;
+    curr->exec_start = now;
+    if (delta == 0) {
+        return;
+    }
+
+    /* Accumulate actual runtime */
+    curr->sum_exec_runtime += delta;
+
+    /* Heavier tasks accumulate vruntime more slowly */
+    curr->vruntime += calc_delta_fair(delta, curr);
+    update_min_vruntime(rq);
+}
+
+/* Wall-clock slice for a task: its weighted share of the scheduling period
+ * (SCHED_BATCH tasks run for at least SCHED_BATCH_MIN_SLICE_NS, trading
+ * latency for fewer switches and warmer caches) */
+static uint64_t sched_slice(runqueue_t* rq, task_struct_t* task) {
+    uint64_t period = SCHED_LATENCY_NS;
+    if (rq->nr_running * SCHED_MIN_GRANULARITY_NS > period) {
+        period = rq->nr_running * SCHED_MIN_GRANULARITY_NS;
+    }
+
+    uint64_t slice = period;
+    if (rq->load_weight != 0) {
+        slice = period * task->weight / rq->load_weight;
+    }
+    if (task->policy == SCHED_BATCH && slice < SCHED_BATCH_MIN_SLICE_NS) {
+        slice = SCHED_BATCH_MIN_SLICE_NS;
+    }
+    return slice;
+}
+
+/* Wakeup preemption: preempt if next->vruntime + wakeup_granularity <
+ * curr->vruntime (granularity is converted to next's virtual time)
+ * A SCHED_BATCH task waits for the tick instead */
+static bool check_preempt_curr_fair(runqueue_t* rq, task_struct_t* next) {
+    if (next->policy == SCHED_BATCH) {
+        return false;
+    }
+
+    int64_t vdiff = vruntime_delta(rq->curr->vruntime, next->vruntime);
+    return vdiff > (int64_t)calc_delta_fair(SCHED_WAKEUP_GRANULARITY_NS, next);
+}
+
+/* Tick preemption: current has used its slice or fallen too far behind leftmost */
+static void task_tick_fair(runqueue_t* rq, task_struct_t* curr) {
+    if (rq->nr_running < 2) {
+        return;
+    }
+
+    uint64_t ideal = sched_slice(rq, curr);
+    uint64_t ran = curr->sum_exec_runtime - curr->prev_sum_exec_runtime;
+
+    if (ran > ideal) {
+        set_need_resched(rq);
+        return;
+    }
+    if (ran < SCHED_MIN_GRANULARITY_NS) {
+        return;
+    }
+
+    task_struct_t* first = rb_task(rb_first_cached(&rq->tasks_timeline));
+    if (first && vruntime_delta(curr->vruntime, first->vruntime) > (int64_t)ideal) {
+        set_need_resched(rq);
+    }
+}
+
+/******************************************************************************
+ * Timeline
+ *****************************************************************************/
+
+static void init_rq_fair(runqueue_t* rq) {
+    rq->tasks_timeline = (rb_root_t)RB_ROOT_INIT;
+    rq->min_vruntime = 0;
+}
+
+/* Place a task's vruntime relative to min_vruntime before it joins the tree
+ * New tasks start at min_vruntime; woken sleepers get at most half a
+ * latency period of credit so they cannot monopolize the CPU */
+static void place_entity(runqueue_t* rq, task_struct_t* task, bool initial) {
+    uint64_t vruntime = rq->min_vruntime;
+
+    if (!initial) {
+        vruntime -= SCHED_LATENCY_NS / 2;
+    }
+    if (vruntime_delta(task->vruntime, vruntime) < 0) {
+        task->vruntime = vruntime;
+    }
+}
+
+static void enqueue_task_fair(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    if (flags & ENQUEUE_WAKEUP) {
+        place_entity(rq, task, flags & ENQUEUE_INITIAL);
+    }
+    rb_insert(&rq->tasks_timeline, &task->run_node, vruntime_less);
+    rq_set_queued(rq, &fair_sched_class, true);
+}
+
+static void dequeue_task_fair(runqueue_t* rq, task_struct_t* task) {
+    rb_delete(&rq->tasks_timeline, &task->run_node);
+    rq_set_queued(rq, &fair_sched_class, rb_first_cached(&rq->tasks_timeline) != NULL);
+}
+
+/* Leftmost vruntime, skipping a task that just yielded */
+static task_struct_t* pick_next_task_fair(runqueue_t* rq) {
+    rb_node_t* left = rb_first_cached(&rq->tasks_timeline);
+    task_struct_t* next = rb_task(left);
+
+    if (next == rq->skip) {
+        rb_node_t* second = rb_next(left);
+        if (second) {
+            next = rb_task(second);
+        }
+    }
+    return next;
+}
+
+static void put_prev_task_fair(runqueue_t* rq, task_struct_t* task) {
+    enqueue_task_fair(rq, task, 0);
+}
+
+const sched_class_t fair_sched_class = {
+    .next               = &bg_sched_class,
+    .rank               = SCHED_CLASS_FAIR,
+    .init_rq            = init_rq_fair,
+    .enqueue_task       = enqueue_task_fair,
+    .dequeue_task       = dequeue_task_fair,
+    .pick_next_task     = pick_next_task_fair,
+    .put_prev_task      = put_prev_task_fair,
+    .task_tick          = task_tick_fair,
+    .update_curr        = update_curr_fair,
+    .check_preempt_curr = check_preempt_curr_fair,
+};
+
+/******************************************************************************
+ * Load Balancing
+ * --------------
+ * Pull model: a CPU takes queued tasks from the runqueue with the highest
+ * weighted load, periodically from the tick and right away when it is about
+ * to go idle. Running tasks are never moved.
+ *****************************************************************************/
+
+/* Lock busiest while holding this_rq->lock; returns false if it is busy
+ * Locks nest lower CPU first, so a lower busiest is only tried: dropping
+ * this_rq->lock to take them in order would expose the callers' half-done
+ * state (__schedule() has already requeued or dequeued prev, which is
+ * still rq->curr) to wakeups and other balancers. */
+static bool double_lock_balance(runqueue_t* this_rq, runqueue_t* busiest) {
+    if (busiest->cpu < this_rq->cpu) {
+        return spin_trylock(&busiest->lock);
+    }
+    spin_lock(&busiest->lock);
+    return true;
+}
+
+/* Runqueue with the highest weighted load that has a queued task to give */
+static runqueue_t* find_busiest_rq(runqueue_t* this_rq) {
+    runqueue_t* busiest = NULL;
+    uint64_t max_load = this_rq->load_weight;
+
+    /* Unlocked snapshot; load_balance() rechecks under the locks */
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        runqueue_t* rq = cpu_rq(cpu);
+        if (rq == this_rq || !smp_cpu_online(cpu) || rq->nr_running < 2) {
+            continue;
+        }
+        if (rq->load_weight > max_load) {
+            max_load = rq->load_weight;
+            busiest = rq;
+        }
+    }
+    return busiest;
+}
+
+/* May a queued task of src move to another CPU? (CFS and background tasks
+ * are scanned) */
+static bool can_migrate_task(runqueue_t* src, task_struct_t* task, bool idle) {
+    if (task->on_cpu || task->cpu_bound) {
+        return false;
+    }
+    /* A busy CPU leaves cache-hot tasks alone; an idle one takes anything */
+    return idle || !task_hot(src, task);
+}
+
+/* Move a queued CFS or background task from src to dst (both locked) */
+static void migrate_task(runqueue_t* src, runqueue_t* dst, task_struct_t* task) {
+    const sched_class_t* class = task->sched_class;
+
+    class->dequeue_task(src, task);
+    src->nr_running--;
+    src->nr_running_class[class->rank]--;
+    src->load_weight -= task->weight;
+    if (src->skip == task) {
+        src->skip = NULL;
+    }
+
+    /* Keep the task's lag relative to the queue it joins */
+    if (class == &fair_sched_class) {
+        task->vruntime = task->vruntime - src->min_vruntime + dst->min_vruntime;
+    }
+    task->cpu = dst->cpu;
+    task->nr_migrations++;
+
+    class->enqueue_task(dst, task, 0);
+    dst->nr_running++;
+    dst->nr_running_class[class->rank]++;
+    dst->load_weight += task->weight;
+
+    src->stats.migrations_out++;
+    dst->stats.migrations_in++;
+}
+
+/* Pull up to half the load difference from the busiest runqueue
+ * Called with this_rq->lock held; it is never dropped, so callers may
+ * be in the middle of a switch. A contended busiest is skipped until the
+ * next balance pass. */
+uint32_t load_balance(runqueue_t* this_rq, bool idle) {
+    runqueue_t* busiest = find_busiest_rq(this_rq);
+    if (busiest == NULL) {
+        return 0;
+    }
+
+    this_rq->stats.steal_attempts++;
+    if (!double_lock_balance(this_rq, busiest)) {
+        return 0;
+    }
+
+    uint32_t moved = 0;
+    task_struct_t* last = NULL;
+
+    if (busiest->nr_running >= 2 && busiest->load_weight > this_rq->load_weight) {
+        uint64_t imbalance = (busiest->load_weight - this_rq->load_weight) / 2;
+        rb_node_t* node = rb_first_cached(&busiest->tasks_timeline);
+
+        while (node && imbalance > 0 && moved < SCHED_BALANCE_MAX_MOVE) {
+            task_struct_t* task = rb_task(node);
+            node = rb_next(node);
+
+            if (!can_migrate_task(busiest, task, idle)) {
+                continue;
+            }
+            /* Overshooting is only worth it to give an idle CPU some work */
+            if (task->weight > imbalance && !(idle && moved == 0)) {
+                continue;
+            }
+
+            migrate_task(busiest, this_rq, task);
+            imbalance = task->weight >= imbalance ? 0 : imbalance - task->weight;
+            last = task;
+            moved++;
+        }
+    }
+
+    /* No CFS task to take: a CPU with nothing at all to run pulls the
+     * first background task that may move (one already running background
+     * work does not, or two of them would pass tasks back and forth) */
+    if (idle && moved == 0 && this_rq->nr_running == 0 && busiest->nr_running >= 2) {
+        list_head_t* head = &busiest->bg.queue;
+        for (list_head_t* n = head->next; n != head; n = n->next) {
+            task_struct_t* task = list_entry(n, task_struct_t, run_list);
+            if (can_migrate_task(busiest, task, idle)) {
+                migrate_task(busiest, this_rq, task);
+                last = task;
+                moved++;
+                break;
+            }
+        }
+    }
+
+    spin_unlock(&busiest->lock);
+
+    if (moved) {
+        this_rq->stats.steal_success++;
+        if (check_preempt_curr(this_rq, last)) {
+            set_need_resched(this_rq);
+        }
+    }
+    return moved;
+}
+
+/* A tickless idle CPU has no tick to balance from: wake one so that it
+ * pulls from this overloaded runqueue (through idle balancing in schedule) */
+void nohz_balance_kick(runqueue_t* rq) {
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        runqueue_t* idle_rq = cpu_rq(cpu);
+        if (idle_rq == rq || !smp_cpu_online(cpu) || !idle_rq->nohz_idle) {
+            continue;
+        }
+
+        /* Unlocked: at worst the target runs one needless schedule() */
+        idle_rq->nohz_idle = false;
+        set_need_resched(idle_rq);
+        smp_send_reschedule(cpu);
+        rq->stats.nohz_kicks++;
+        return;
+    }
+}
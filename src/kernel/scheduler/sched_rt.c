@@ -0,0 +1,74 @@
+/**
+ * Real-Time Scheduling Class (SCHED_FIFO / SCHED_RR)
+ *
+ * Real-time tasks always run before CFS tasks. The priority array makes
+ * enqueue, dequeue and pick_next all O(1).
+ */
+
+#include <kernel/sched_class.h>
+
+static void init_rq_rt(runqueue_t* rq) {
+    rq->rt.bitmap = 0;
+    for (uint32_t prio = 0; prio < MAX_RT_PRIO; prio++) {
+        list_init(&rq->rt.queue[prio]);
+    }
+}
+
+/* Queue at the tail of its priority list, or at the head if it was preempted */
+static void enqueue_task_rt(runqueue_t* rq, task_struct_t* task, uint32_t flags) {
+    list_head_t* queue = &rq->rt.queue[task->rt_priority];
+
+    if (flags & ENQUEUE_HEAD) {
+        list_add(&task->run_list, queue);
+    } else {
+        list_add_tail(&task->run_list, queue);
+    }
+    rq->rt.bitmap |= 1ULL << task->rt_priority;
+    rq_set_queued(rq, &rt_sched_class, true);
+}
+
+static void dequeue_task_rt(runqueue_t* rq, task_struct_t* task) {
+    list_del(&task->run_list);
+    if (list_empty(&rq->rt.queue[task->rt_priority])) {
+        rq->rt.bitmap &= ~(1ULL << task->rt_priority);
+    }
+    rq_set_queued(rq, &rt_sched_class, rq->rt.bitmap != 0);
+}
+
+/* Highest priority queued task: one count-leading-zeros and a list head read */
+static task_struct_t* pick_next_task_rt(runqueue_t* rq) {
+    uint32_t prio = 63 - __builtin_clzll(rq->rt.bitmap);
+    return list_first_entry(&rq->rt.queue[prio], task_struct_t, run_list);
+}
+
+/* A preempted task keeps its place at the head of its priority list; one
+ * that yielded or used up its RR slice goes to the tail */
+static void put_prev_task_rt(runqueue_t* rq, task_struct_t* task) {
+    enqueue_task_rt(rq, task, slice_requeue_flags(rq, task, task->policy == SCHED_RR));
+}
+
+/* RR tick: at the end of the slice, round-robin among equal priorities */
+static void task_tick_rt(runqueue_t* rq, task_struct_t* curr) {
+    if (curr->policy != SCHED_RR) {
+        return;     /* FIFO has no time slice */
+    }
+    slice_tick(rq, curr, &rq->rt.queue[curr->rt_priority]);
+}
+
+/* A higher rt_priority beats a lower one; equal priorities wait their turn */
+static bool check_preempt_curr_rt(runqueue_t* rq, task_struct_t* next) {
+    return next->rt_priority > rq->curr->rt_priority;
+}
+
+const sched_class_t rt_sched_class = {
+    .next               = &fair_sched_class,
+    .rank               = SCHED_CLASS_RT,
+    .init_rq            = init_rq_rt,
+    .enqueue_task       = enqueue_task_rt,
+    .dequeue_task       = dequeue_task_rt,
+    .pick_next_task     = pick_next_task_rt,
+    .put_prev_task      = put_prev_task_rt,
+    .task_tick          = task_tick_rt,
+    .update_curr        = update_curr_common,
+    .check_preempt_curr = check_preempt_curr_rt,
+};
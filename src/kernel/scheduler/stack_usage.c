@@ -0,0 +1,160 @@
+/**
+ * Stack Usage Profiling
+ *
+ * task_create() paints each new stack with a known pattern. The deepest
+ * point a task ever reached is then the lowest word no longer holding the
+ * pattern (stacks grow down from the top). The reaper records it per task
+ * name before the stack is freed; the report adds the live tasks, so stack
+ * sizes can be chosen from observed depth instead of guessed.
+ *
+ * The report prints from a snapshot of the table: the console is slow,
+ * and recording an exit must not wait (IRQs off) behind it.
+ */
+
+#include <kernel/sched.h>
+#include <kernel/console.h>
+#include <kernel/mutex.h>
+#include <kernel/spinlock.h>
+#include <kernel/string.h>
+
+#define STACK_PAINT         0x57ac57ac57ac57acULL
+#define STACK_USAGE_NAMES   64  /* Distinct task names tracked */
+#define STACK_USAGE_WARN    75  /* Percent of the stack: report as near overflow */
+
+/* Deepest usage seen per task name */
+typedef struct stack_usage_entry {
+    char name[16];
+    uint32_t max_used;      /* Bytes */
+    uint32_t stack_size;    /* Size of the stack that saw max_used */
+    uint64_t samples;       /* Exits recorded */
+} stack_usage_entry_t;
+
+static spinlock_t stack_usage_lock = SPINLOCK_INIT;
+static stack_usage_entry_t stack_usage_table[STACK_USAGE_NAMES];
+static uint32_t stack_usage_names;
+static uint64_t stack_usage_dropped;    /* Samples lost to a full table */
+
+/* Report copy of the table (too big for a task stack); one report at a time */
+static mutex_t stack_usage_report_mutex = MUTEX_INIT(stack_usage_report_mutex);
+static stack_usage_entry_t stack_usage_snapshot[STACK_USAGE_NAMES];
+
+/* Fill a new task's stack with the pattern (before its context is set up) */
+void stack_paint(void* stack, uint32_t size) {
+    uint64_t* word = (uint64_t*)stack;
+    uint64_t* top = (uint64_t*)((uint8_t*)stack + size);
+
+    while (word < top) {
+        *word++ = STACK_PAINT;
+    }
+}
+
+/* Deepest stack usage of a task so far, in bytes (0 for the idle tasks,
+ * which run on their CPU's boot stack) */
+uint32_t stack_usage(task_struct_t* task) {
+    if (!task->kernel_stack) {
+        return 0;
+    }
+
+    const uint64_t* word = (const uint64_t*)task->kernel_stack;
+    const uint64_t* top = (const uint64_t*)((uint8_t*)task->kernel_stack +
+                                            task->kernel_stack_size);
+    while (word < top && *word == STACK_PAINT) {
+        word++;
+    }
+    return (uint32_t)((const uint8_t*)top - (const uint8_t*)word);
+}
+
+/* Fold a task's usage into the entry for its name */
+void stack_usage_record(task_struct_t* task) {
+    if (!task->kernel_stack) {
+        return;
+    }
+    uint32_t used = stack_usage(task);
+
+    uint64_t flags = spin_lock_irqsave(&stack_usage_lock);
+
+    stack_usage_entry_t* entry = NULL;
+    for (uint32_t i = 0; i < stack_usage_names; i++) {
+        if (strcmp(stack_usage_table[i].name, task->name) == 0) {
+            entry = &stack_usage_table[i];
+            break;
+        }
+    }
+    if (!entry && stack_usage_names < STACK_USAGE_NAMES) {
+        entry = &stack_usage_table[stack_usage_names++];
+        memcpy(entry->name, task->name, sizeof(entry->name));
+    }
+
+    if (entry) {
+        if (used >= entry->max_used) {
+            entry->max_used = used;
+            entry->stack_size = task->kernel_stack_size;
+        }
+        entry->samples++;
+    } else {
+        stack_usage_dropped++;
+    }
+
+    spin_unlock_irqrestore(&stack_usage_lock, flags);
+}
+
+/* Entry for name in the first *count snapshot entries, appended (with no
+ * samples) if missing and there is room */
+static stack_usage_entry_t* snapshot_entry(const char* name, uint32_t* count) {
+    for (uint32_t i = 0; i < *count; i++) {
+        if (strcmp(stack_usage_snapshot[i].name, name) == 0) {
+            return &stack_usage_snapshot[i];
+        }
+    }
+    if (*count == STACK_USAGE_NAMES) {
+        return NULL;
+    }
+
+    stack_usage_entry_t* entry = &stack_usage_snapshot[(*count)++];
+    memcpy(entry->name, name, sizeof(entry->name));
+    entry->max_used = 0;
+    entry->stack_size = 0;
+    entry->samples = 0;
+    return entry;
+}
+
+/* Print the deepest usage per task name, live tasks included; entries at
+ * STACK_USAGE_WARN% or more of their stack are flagged (task context) */
+void stack_usage_report(void) {
+    mutex_lock(&stack_usage_report_mutex);
+
+    uint64_t flags = spin_lock_irqsave(&stack_usage_lock);
+    uint32_t count = stack_usage_names;
+    uint64_t dropped = stack_usage_dropped;
+    memcpy(stack_usage_snapshot, stack_usage_table, count * sizeof(stack_usage_entry_t));
+    spin_unlock_irqrestore(&stack_usage_lock, flags);
+
+    /* Live tasks only raise the maximum shown here; samples count exits */
+    for (uint32_t i = 0; i < MAX_TASKS; i++) {
+        char name[16];
+        uint32_t used, size;
+        if (!task_stack_sample(i, name, &used, &size)) {
+            continue;
+        }
+        stack_usage_entry_t* entry = snapshot_entry(name, &count);
+        if (entry && used >= entry->max_used) {
+            entry->max_used = used;
+            entry->stack_size = size;
+        }
+    }
+
+    console_printf("Stack usage (deepest per task name):\n");
+    for (uint32_t i = 0; i < count; i++) {
+        stack_usage_entry_t* entry = &stack_usage_snapshot[i];
+        uint32_t percent = entry->stack_size ? entry->max_used * 100 / entry->stack_size : 0;
+        console_printf("  %s: %u/%u bytes (%u%%) samples=%llu%s\n",
+                       entry->name, entry->max_used, entry->stack_size, percent,
+                       entry->samples, percent >= STACK_USAGE_WARN ? "  NEAR OVERFLOW" : "");
+    }
+    if (dropped) {
+        console_printf("  (%llu samples dropped: more than %u task names)\n",
+                       dropped, STACK_USAGE_NAMES);
+    }
+
+    mutex_unlock(&stack_usage_report_mutex);
+}
@@ -1,32 +1,225 @@
 /**
  * Task Management - Creation and Destruction
+ *
+ * task_table slots and PIDs are recycled: free slots sit on a free list,
+ * PIDs come from a two-level bitmap, and an exiting task is reaped by the
+ * next task on its CPU once it is off its own stack (finish_task_switch()).
+ * Creation, lookup and reaping are all constant time.
  */
 
 #include <kernel/sched.h>
 #include <kernel/console.h>
 #include <kernel/mm.h>
+#include <kernel/spinlock.h>
 #include <kernel/string.h>
+#include <arch/interrupts.h>
 
 extern task_struct_t task_table[MAX_TASKS];
-extern uint32_t next_pid;
 
 /* Architecture-specific: setup initial task context */
 extern void arch_setup_task_context(task_struct_t* task, void (*entry)(void));
 
-/* Create new task */
-task_struct_t* task_create(const char* name, void (*entry)(void),
-                           uint8_t priority, uint32_t stack_size) {
-    /* Find free PID */
-    if (next_pid >= MAX_TASKS) {
+#define PID_MAP_WORDS (PID_MAX / 64)
+
+_Static_assert(PID_MAP_WORDS <= 64, "pid_free_words has one bit per pid_map word");
+_Static_assert(MAX_TASKS < PID_MAX, "every task slot needs a PID");
+
+/* Task table state, protected by task_lock (taken with IRQs disabled) */
+static spinlock_t task_lock = SPINLOCK_INIT;
+static task_struct_t* free_tasks;           /* Free slots, linked through next */
+static uint64_t pid_map[PID_MAP_WORDS];     /* Bit set = PID in use */
+static uint64_t pid_free_words;             /* Bit w set = pid_map[w] has a free PID */
+static task_struct_t* pid_table[PID_MAX];   /* PID -> task */
+static uint32_t last_pid;                   /* Allocation resumes after this PID */
+static uint32_t nr_tasks;                   /* Slots in use (including idle tasks) */
+
+/******************************************************************************
+ * PID Allocator
+ * -------------
+ * Allocation continues after the last PID handed out, so a PID is only
+ * reused after the whole space has gone round. Finding the next free PID
+ * is two bit scans: one in the word it falls in, one in pid_free_words.
+ *****************************************************************************/
+
+/* First free PID in word w at or above bit (0 if none) */
+static uint32_t pid_scan_word(uint32_t w, uint32_t bit) {
+    uint64_t avail = ~pid_map[w] & (~0ULL << bit);
+    return avail ? w * 64 + __builtin_ctzll(avail) : 0;
+}
+
+static void pid_mark(uint32_t pid, bool used) {
+    uint32_t w = pid / 64;
+    uint64_t bit = 1ULL << (pid % 64);
+
+    if (used) {
+        pid_map[w] |= bit;
+        if (pid_map[w] == ~0ULL) {
+            pid_free_words &= ~(1ULL << w);
+        }
+    } else {
+        pid_map[w] &= ~bit;
+        pid_free_words |= 1ULL << w;
+    }
+}
+
+/* Allocate a PID (task_lock held); returns 0 if all are in use */
+static uint32_t pid_alloc(void) {
+    uint32_t start = last_pid + 1 < PID_MAX ? last_pid + 1 : 1;
+    uint32_t w = start / 64;
+    uint32_t pid = pid_scan_word(w, start % 64);
+
+    if (pid == 0) {
+        /* Next word with room above w, else wrap around to the lowest */
+        uint64_t words = (w + 1 < 64) ? pid_free_words & (~0ULL << (w + 1)) : 0;
+        if (!words) {
+            words = pid_free_words;
+        }
+        if (!words) {
+            return 0;
+        }
+        pid = pid_scan_word(__builtin_ctzll(words), 0);
+    }
+
+    pid_mark(pid, true);
+    last_pid = pid;
+    return pid;
+}
+
+/* Look up a live task by PID (NULL if none; PID 0 is the idle tasks') */
+task_struct_t* find_task_by_pid(uint32_t pid) {
+    if (pid == 0 || pid >= PID_MAX) {
+        return NULL;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+    task_struct_t* task = pid_table[pid];
+    spin_unlock_irqrestore(&task_lock, flags);
+    return task;
+}
+
+/******************************************************************************
+ * Task Slots
+ *****************************************************************************/
+
+/* Reset the task table (boot CPU, before any task exists) */
+void task_table_init(void) {
+    memset(task_table, 0, sizeof(task_table));
+    memset(pid_map, 0, sizeof(pid_map));
+    memset(pid_table, 0, sizeof(pid_table));
+
+    /* Slot 0 ends up first on the free list */
+    free_tasks = NULL;
+    for (uint32_t i = MAX_TASKS; i-- > 0;) {
+        task_table[i].state = TASK_DEAD;
+        task_table[i].next = free_tasks;
+        free_tasks = &task_table[i];
+    }
+
+    pid_free_words = ~0ULL >> (64 - PID_MAP_WORDS);
+    pid_mark(0, true);  /* Shared by the idle tasks, never handed out */
+    last_pid = 0;
+    nr_tasks = 0;
+}
+
+/* Take a free slot and give it a PID (or PID 0 for an idle task)
+ * Returns a zeroed task, or NULL if the table is full */
+static task_struct_t* task_alloc(bool idle) {
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+
+    task_struct_t* task = free_tasks;
+    uint32_t pid = 0;
+    if (task && !idle) {
+        pid = pid_alloc();
+        if (pid == 0) {
+            task = NULL;
+        }
+    }
+    if (task) {
+        free_tasks = task->next;
+        pid_table[pid] = idle ? NULL : task;
+        nr_tasks++;
+    }
+
+    spin_unlock_irqrestore(&task_lock, flags);
+
+    if (!task) {
         console_printf("ERROR: MAX_TASKS reached\n");
         return NULL;
     }
 
-    task_struct_t* task = &task_table[next_pid++];
     memset(task, 0, sizeof(task_struct_t));
+    task->pid = pid;
+    return task;
+}
 
-    /* Initialize task */
-    task->pid = next_pid - 1;
+/* Put a slot and its PID back (task no longer referenced by the scheduler) */
+static void task_free(task_struct_t* task) {
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+
+    if (task->pid != 0) {
+        pid_table[task->pid] = NULL;
+        pid_mark(task->pid, false);
+    }
+    task->pid = 0;
+    task->state = TASK_DEAD;
+    task->next = free_tasks;
+    free_tasks = task;
+    nr_tasks--;
+
+    spin_unlock_irqrestore(&task_lock, flags);
+}
+
+/* Reaper: release a zombie once nothing runs on its stack any more
+ * (called by the next task on its CPU, see finish_task_switch()) */
+void task_reap(task_struct_t* task) {
+    stack_usage_record(task);
+
+    /* Unpublished under task_lock: task_stack_sample() may be scanning it */
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+    void* stack = task->kernel_stack;
+    task->kernel_stack = NULL;
+    spin_unlock_irqrestore(&task_lock, flags);
+
+    stack_free(stack, task->kernel_stack_size);
+    task_free(task);
+}
+
+/* Measure the stack of the live task in a slot, with its name and stack
+ * size; false if the slot has no such task. task_lock keeps the stack
+ * from being freed or the slot reused while it is scanned. */
+bool task_stack_sample(uint32_t slot, char name[16], uint32_t* used, uint32_t* size) {
+    task_struct_t* task = &task_table[slot];
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+
+    bool live = task->state != TASK_DEAD && task->state != TASK_ZOMBIE &&
+                task->pid != 0 && task->kernel_stack;
+    if (live) {
+        memcpy(name, task->name, 16);
+        *used = stack_usage(task);
+        *size = task->kernel_stack_size;
+    }
+
+    spin_unlock_irqrestore(&task_lock, flags);
+    return live;
+}
+
+/* Number of task slots in use (including the idle tasks) */
+uint32_t task_count(void) {
+    return nr_tasks;
+}
+
+/* Create new task with the given policy */
+task_struct_t* task_create_policy(const char* name, void (*entry)(void), uint8_t priority,
+                                  uint8_t policy, uint32_t stack_size) {
+    if (policy != SCHED_NORMAL && policy != SCHED_BATCH && policy != SCHED_IDLE) {
+        console_printf("ERROR: Invalid policy %u for task %s\n", policy, name);
+        return NULL;
+    }
+
+    task_struct_t* task = task_alloc(false);
+    if (!task) {
+        return NULL;
+    }
 
     /* Copy name manually (avoid strncpy) */
     int i;
@@ -36,24 +229,29 @@ task_struct_t* task_create(const char* name, void (*entry)(void),
     task->name[i] = '\0';
 
     task->priority = priority;
-    task->policy = SCHED_RR;
+    task->policy = policy;
     task->state = TASK_READY;
     task->time_slice = DEFAULT_TIMESLICE;
 
-    /* Initialize CFS fields */
-    task->vruntime = 0;
-    task->exec_start = 0;
-    task->weight = 1024;  /* Default weight (normal priority) */
-    task->sum_exec_runtime = 0;
+    /* Scheduling class and weight (from policy and priority) */
+    sched_task_init(task);
 
-    /* Allocate kernel stack */
-    task->kernel_stack_size = stack_size;
-    task->kernel_stack = kmalloc(stack_size);
-    if (!task->kernel_stack) {
+    /* Allocate kernel stack (page-aligned, from this CPU's stack cache) */
+    void* stack = stack_alloc(stack_size);
+    if (!stack) {
         console_printf("ERROR: Failed to allocate stack for task %s\n", name);
+        task_free(task);
         return NULL;
     }
 
+    /* Fill with a pattern so stack_usage() can find the deepest point, then
+     * publish it (task_stack_sample() reads it under task_lock) */
+    task->kernel_stack_size = stack_size_round(stack_size);
+    stack_paint(stack, task->kernel_stack_size);
+    uint64_t flags = spin_lock_irqsave(&task_lock);
+    task->kernel_stack = stack;
+    spin_unlock_irqrestore(&task_lock, flags);
+
     /* Setup initial context (arch-specific) */
     arch_setup_task_context(task, entry);
 
@@ -63,14 +261,51 @@ task_struct_t* task_create(const char* name, void (*entry)(void),
     return task;
 }
 
+/* Create new task (SCHED_NORMAL) */
+task_struct_t* task_create(const char* name, void (*entry)(void),
+                           uint8_t priority, uint32_t stack_size) {
+    return task_create_policy(name, entry, priority, SCHED_NORMAL, stack_size);
+}
+
+/* Create the idle task of the calling CPU
+ * It has no stack of its own: the CPU's boot context becomes the task and
+ * is already running, so no initial context is set up either */
+task_struct_t* task_create_idle(void) {
+    task_struct_t* task = task_alloc(true);  /* All idle tasks share PID 0 */
+    if (!task) {
+        return NULL;
+    }
+
+    memcpy(task->name, "idle", 5);
+    task->priority = 0;
+    task->policy = SCHED_NORMAL;
+    task->state = TASK_RUNNING;
+
+    sched_task_init(task);
+
+    return task;
+}
+
 /* Exit current task */
 void task_exit(void) {
     task_struct_t* task = get_current_task();
     console_printf("[Task %s] Exiting\n", task->name);
 
-    task->state = TASK_ZOMBIE;
-    kfree(task->kernel_stack);
+    /* Give back reserved deadline bandwidth; the replenishment timer must
+     * be idle before the slot can be reused */
+    if (task->policy == SCHED_DEADLINE) {
+        sched_setscheduler(task, SCHED_NORMAL, 0);
+    }
+    hrtimer_cancel(&task->dl_timer);
 
-    /* Trigger reschedule - will never return */
+    /* Leave the runqueue for good (IRQs off: a preemption now would make
+     * us runnable again); the stack is in use until the switch, so the
+     * next task reaps us */
+    interrupts_disable();
+    task->state = TASK_ZOMBIE;
     schedule();
+
+    /* Not reached */
+    for (;;) {
+    }
 }
@@ -4,6 +4,11 @@
 
 #include <kernel/sched.h>
 #include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/tick.h>
+
+/* Task C prints the debug reports every this many iterations */
+#define TEST_REPORT_INTERVAL    20
 
 void test_task_a(void) {
     for (int i = 0; i < 10; i++) {
@@ -27,6 +32,10 @@ void test_task_c(void) {
     int i = 0;
     while (1) {
         console_printf("[Task C] Running (iteration %d)\n", i++);
-        task_yield();
+        if (i % TEST_REPORT_INTERVAL == 0) {
+            tick_print_stats();
+            stack_usage_report();
+        }
+        task_sleep_ns(500 * NSEC_PER_MSEC);     /* Block instead of spinning */
     }
 }
@@ -0,0 +1,113 @@
+/**
+ * Wait Queues and Timed Sleep
+ *
+ * Blocked tasks are off the runqueue entirely; wake_up_process() puts them
+ * back through the same path as task_ready(), with a sleeper's vruntime
+ * credit. Timed sleeps arm an hrtimer on the sleeper's stack whose
+ * callback does the wakeup.
+ */
+
+#include <kernel/wait.h>
+#include <kernel/hrtimer.h>
+#include <kernel/preempt.h>
+#include <arch/interrupts.h>
+
+void init_waitqueue_head(wait_queue_head_t* wq) {
+    spin_lock_init(&wq->lock);
+    list_init(&wq->head);
+}
+
+void init_wait_entry(wait_queue_entry_t* wait) {
+    list_init(&wait->entry);
+    wait->task = get_current_task();
+}
+
+/* Queue the waiter and set its state under the queue lock: a waker takes
+ * the same lock, so it either sees the new state or runs before it */
+void prepare_to_wait(wait_queue_head_t* wq, wait_queue_entry_t* wait, task_state_t state) {
+    uint64_t flags = spin_lock_irqsave(&wq->lock);
+
+    if (list_empty(&wait->entry)) {
+        list_add_tail(&wait->entry, &wq->head);
+    }
+    set_current_state(state);
+
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void finish_wait(wait_queue_head_t* wq, wait_queue_entry_t* wait) {
+    set_current_state(TASK_RUNNING);
+
+    uint64_t flags = spin_lock_irqsave(&wq->lock);
+    if (!list_empty(&wait->entry)) {
+        list_del(&wait->entry);
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/* Dequeue and wake up to nr waiters, oldest first */
+static uint32_t __wake_up(wait_queue_head_t* wq, uint32_t nr) {
+    uint32_t woken = 0;
+
+    uint64_t flags = spin_lock_irqsave(&wq->lock);
+
+    while (woken < nr && !list_empty(&wq->head)) {
+        wait_queue_entry_t* wait = list_first_entry(&wq->head, wait_queue_entry_t, entry);
+        list_del(&wait->entry);
+        if (wake_up_process(wait->task)) {
+            woken++;
+        }
+    }
+
+    spin_unlock_irqrestore(&wq->lock, flags);
+
+    preempt_check_resched();
+    return woken;
+}
+
+uint32_t wake_up(wait_queue_head_t* wq) {
+    return __wake_up(wq, 0xFFFFFFFFu);
+}
+
+uint32_t wake_up_one(wait_queue_head_t* wq) {
+    return __wake_up(wq, 1);
+}
+
+/* Timeout of a sleeping task */
+static hrtimer_restart_t sleep_timer_fn(hrtimer_t* timer) {
+    wake_up_process((task_struct_t*)timer->data);
+    return HRTIMER_NORESTART;
+}
+
+/* Sleep until woken or the absolute expiry (state already set by the caller) */
+static void schedule_until(uint64_t expires) {
+    hrtimer_t timer;
+
+    hrtimer_init(&timer, sleep_timer_fn, get_current_task());
+    hrtimer_start(&timer, expires, HRTIMER_MODE_ABS);
+    schedule();
+
+    /* The timer lives on this stack: wait out a callback still running */
+    hrtimer_cancel(&timer);
+}
+
+uint64_t schedule_timeout(uint64_t timeout_ns) {
+    uint64_t expires = timer_get_ns() + timeout_ns;
+
+    schedule_until(expires);
+
+    uint64_t now = timer_get_ns();
+    return now < expires ? expires - now : 0;
+}
+
+/* Sleep until deadline (spurious wakeups go back to sleep) */
+void task_sleep_until(uint64_t deadline_ns) {
+    while (timer_get_ns() < deadline_ns) {
+        set_current_state(TASK_SLEEPING);
+        schedule_until(deadline_ns);
+    }
+}
+
+void task_sleep_ns(uint64_t ns) {
+    task_sleep_until(timer_get_ns() + ns);
+}
@@ -0,0 +1,60 @@
+/**
+ * SMP Common Code - per-CPU areas and online CPU tracking
+ */
+
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+
+/* Per-CPU areas, indexed by logical CPU number */
+cpu_local_t cpu_locals[MAX_CPUS];
+
+/* IRQ stacks: handlers run here, so task stacks need no room for them */
+static uint8_t irq_stacks[MAX_CPUS][IRQ_STACK_SIZE] __attribute__((aligned(16)));
+
+/* Bitmask of online CPUs (writers serialized by cpu_online_lock) */
+static volatile uint32_t cpu_online_mask = 0;
+static spinlock_t cpu_online_lock = SPINLOCK_INIT;
+
+/**
+ * Get the initial stack pointer of a CPU's IRQ stack
+ */
+uint64_t smp_irq_stack_top(uint32_t cpu) {
+    return (uint64_t)&irq_stacks[cpu][IRQ_STACK_SIZE];
+}
+
+/**
+ * Mark the calling CPU online
+ */
+void smp_mark_online(void) {
+    cpu_local_t* cpu = this_cpu();
+
+    spin_lock(&cpu_online_lock);
+    cpu_online_mask |= 1U << cpu->cpu_id;
+    cpu->online = true;
+    spin_unlock(&cpu_online_lock);
+}
+
+/**
+ * Get number of online CPUs
+ */
+uint32_t smp_num_cpus(void) {
+    uint32_t mask = cpu_online_mask;
+    uint32_t count = 0;
+
+    /* Manual popcount: libgcc is not linked */
+    while (mask) {
+        mask &= mask - 1;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Check whether a CPU is online
+ */
+bool smp_cpu_online(uint32_t cpu) {
+    if (cpu >= MAX_CPUS) {
+        return false;
+    }
+    return (cpu_online_mask >> cpu) & 1;
+}
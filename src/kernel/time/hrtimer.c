@@ -0,0 +1,262 @@
+/**
+ * High-Resolution Timers
+ *
+ * Each CPU has a red-black tree of queued timers keyed by expiry, with a
+ * cached leftmost node for O(1) access to the next one. Whenever the
+ * leftmost timer changes, the CPU's one-shot timer is reprogrammed to it.
+ * A timer is queued on the CPU that started it; callbacks run there from
+ * the timer interrupt with the queue unlocked, so they may start timers
+ * or wake tasks.
+ */
+
+#include <kernel/hrtimer.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupts.h>
+
+/* Per-CPU timer queue; lock is always taken with IRQs disabled */
+typedef struct hrtimer_base {
+    spinlock_t lock;
+    uint32_t cpu;
+    rb_root_t active;           /* Queued timers ordered by expiry */
+    hrtimer_t* running;         /* Timer whose callback is executing */
+    uint64_t next_event;        /* Expiry the hardware is programmed for */
+    bool ready;                 /* Timer hardware of this CPU is set up */
+    bool in_interrupt;          /* hrtimer_interrupt() reprograms on exit */
+} hrtimer_base_t;
+
+static hrtimer_base_t hrtimer_bases[MAX_CPUS];
+
+static inline hrtimer_base_t* this_hrtimer_base(void) {
+    return &hrtimer_bases[smp_processor_id()];
+}
+
+static inline hrtimer_t* rb_hrtimer(rb_node_t* node) {
+    return node ? rb_entry(node, hrtimer_t, node) : NULL;
+}
+
+/* Earlier expiry first; equal expiries keep insertion order */
+static bool hrtimer_less(const rb_node_t* a, const rb_node_t* b) {
+    return rb_entry(a, hrtimer_t, node)->expires < rb_entry(b, hrtimer_t, node)->expires;
+}
+
+/* Program the hardware for the leftmost timer if that changed
+ * (base locked; only for the calling CPU's own base) */
+static void hrtimer_reprogram(hrtimer_base_t* base) {
+    if (!base->ready || base->in_interrupt || base != this_hrtimer_base()) {
+        return;
+    }
+
+    hrtimer_t* first = rb_hrtimer(rb_first_cached(&base->active));
+    uint64_t next = first ? first->expires : HRTIMER_NO_EXPIRY;
+
+    if (next != base->next_event) {
+        base->next_event = next;
+        timer_set_next_event(next);
+    }
+}
+
+static void enqueue_hrtimer(hrtimer_base_t* base, hrtimer_t* timer) {
+    rb_insert(&base->active, &timer->node, hrtimer_less);
+    timer->queued = true;
+}
+
+static void remove_hrtimer(hrtimer_base_t* base, hrtimer_t* timer) {
+    rb_delete(&base->active, &timer->node);
+    timer->queued = false;
+}
+
+/* Lock the base a timer belongs to (it may move while we wait) */
+static hrtimer_base_t* lock_hrtimer_base(hrtimer_t* timer) {
+    for (;;) {
+        hrtimer_base_t* base = timer->base;
+        if (base == NULL) {
+            base = this_hrtimer_base();
+        }
+
+        spin_lock(&base->lock);
+        if (timer->base == base || (timer->base == NULL && base == this_hrtimer_base())) {
+            return base;
+        }
+        spin_unlock(&base->lock);
+    }
+}
+
+/**
+ * Initialize a timer
+ */
+void hrtimer_init(hrtimer_t* timer, hrtimer_fn_t function, void* data) {
+    timer->node.parent = NULL;
+    timer->node.left = NULL;
+    timer->node.right = NULL;
+    timer->expires = 0;
+    timer->function = function;
+    timer->data = data;
+    timer->base = NULL;
+    timer->queued = false;
+}
+
+/**
+ * (Re)start a timer on the calling CPU
+ */
+void hrtimer_start(hrtimer_t* timer, uint64_t time, hrtimer_mode_t mode) {
+    uint64_t flags = interrupts_save();
+    hrtimer_base_t* base = lock_hrtimer_base(timer);
+    hrtimer_base_t* new_base = this_hrtimer_base();
+
+    if (timer->queued) {
+        remove_hrtimer(base, timer);    /* Reprogrammed below if it stays here */
+    }
+
+    /* Move to this CPU, unless the callback is running on the old one
+     * (its hrtimer_interrupt() reprograms that CPU before returning) */
+    if (base != new_base && base->running != timer) {
+        timer->base = new_base;
+        spin_unlock(&base->lock);
+        spin_lock(&new_base->lock);
+        base = new_base;
+    }
+    timer->base = base;
+
+    timer->expires = (mode == HRTIMER_MODE_REL) ? timer_get_ns() + time : time;
+    enqueue_hrtimer(base, timer);
+    hrtimer_reprogram(base);
+
+    spin_unlock_irqrestore(&base->lock, flags);
+}
+
+/**
+ * Cancel a timer without waiting for a running callback
+ */
+int hrtimer_try_to_cancel(hrtimer_t* timer) {
+    if (timer->base == NULL) {
+        return 0;
+    }
+
+    uint64_t flags = interrupts_save();
+    hrtimer_base_t* base = lock_hrtimer_base(timer);
+    int ret = 0;
+
+    if (base->running == timer) {
+        ret = -1;
+    } else if (timer->queued) {
+        remove_hrtimer(base, timer);
+        hrtimer_reprogram(base);
+        ret = 1;
+    }
+
+    spin_unlock_irqrestore(&base->lock, flags);
+    return ret;
+}
+
+/**
+ * Cancel a timer, waiting for a running callback to finish
+ */
+bool hrtimer_cancel(hrtimer_t* timer) {
+    for (;;) {
+        int ret = hrtimer_try_to_cancel(timer);
+        if (ret >= 0) {
+            return ret == 1;
+        }
+        __asm__ volatile("" ::: "memory");
+    }
+}
+
+/**
+ * Check whether a timer is queued
+ */
+bool hrtimer_active(const hrtimer_t* timer) {
+    return timer->queued;
+}
+
+/**
+ * Push the expiry past now in whole intervals
+ */
+uint64_t hrtimer_forward(hrtimer_t* timer, uint64_t now, uint64_t interval) {
+    if (now < timer->expires || interval == 0) {
+        return 0;
+    }
+
+    uint64_t overruns = (now - timer->expires) / interval + 1;
+    timer->expires += overruns * interval;
+    return overruns;
+}
+
+/**
+ * Earliest expiry on this CPU other than exclude
+ */
+uint64_t hrtimer_get_next_event(const hrtimer_t* exclude) {
+    hrtimer_base_t* base = this_hrtimer_base();
+    uint64_t flags = spin_lock_irqsave(&base->lock);
+
+    rb_node_t* node = rb_first_cached(&base->active);
+    if (node && rb_hrtimer(node) == exclude) {
+        node = rb_next(node);
+    }
+    uint64_t next = node ? rb_hrtimer(node)->expires : HRTIMER_NO_EXPIRY;
+
+    spin_unlock_irqrestore(&base->lock, flags);
+    return next;
+}
+
+/**
+ * Set up the calling CPU's queue and program anything already queued
+ */
+void hrtimer_init_cpu(void) {
+    hrtimer_base_t* base = this_hrtimer_base();
+    uint64_t flags = spin_lock_irqsave(&base->lock);
+
+    base->cpu = smp_processor_id();
+    base->next_event = HRTIMER_NO_EXPIRY;
+    base->ready = true;
+    hrtimer_reprogram(base);
+
+    spin_unlock_irqrestore(&base->lock, flags);
+}
+
+/**
+ * Timer interrupt: run every expired timer, then program the next expiry
+ */
+void hrtimer_interrupt(void) {
+    hrtimer_base_t* base = this_hrtimer_base();
+    spin_lock(&base->lock);
+    base->in_interrupt = true;
+
+    uint64_t now = timer_get_ns();
+    hrtimer_t* timer;
+
+    while ((timer = rb_hrtimer(rb_first_cached(&base->active))) != NULL &&
+           timer->expires <= now) {
+        remove_hrtimer(base, timer);
+        base->running = timer;
+
+        /* Unlocked: the callback may start timers or wake tasks */
+        spin_unlock(&base->lock);
+        hrtimer_restart_t restart = timer->function(timer);
+        spin_lock(&base->lock);
+
+        /* Requeue unless the callback already restarted (or moved) it */
+        if (restart == HRTIMER_RESTART && !timer->queued && timer->base == base) {
+            enqueue_hrtimer(base, timer);
+        }
+        base->running = NULL;
+
+        /* Callbacks take time: catch timers that expired meanwhile */
+        now = timer_get_ns();
+    }
+
+    base->in_interrupt = false;
+    base->next_event = 0;   /* Force: the one-shot has fired */
+    hrtimer_reprogram(base);
+    spin_unlock(&base->lock);
+}
+
+/**
+ * Busy-wait delay
+ */
+void ndelay(uint64_t ns) {
+    uint64_t end = timer_get_ns() + ns;
+    while (timer_get_ns() < end) {
+        __asm__ volatile("" ::: "memory");
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * Scheduler Tick and Dynamic Tick (NO_HZ idle)
+ *
+ * The tick is a per-CPU periodic hrtimer. The idle loop calls
+ * tick_nohz_idle_enter() right before it sleeps: if the runqueue is
+ * empty, the tick hrtimer is pushed out to the next event that needs
+ * the tick, so the CPU sleeps until then or until its next hrtimer.
+ * Timer wheel timeouts count as such events, since the wheel is only
+ * advanced by the tick.
+ * Whatever wakes the CPU (a timer, a device IRQ or a reschedule IPI)
+ * puts the tick back in phase first, and the ticks that were skipped
+ * are added to the scheduler clock at once.
+ */
+
+#include <kernel/tick.h>
+#include <kernel/console.h>
+#include <kernel/hrtimer.h>
+#include <kernel/sched.h>
+#include <kernel/smp.h>
+#include <kernel/string.h>
+#include <kernel/timer_wheel.h>
+#include <arch/interrupts.h>
+
+/* Per-CPU tick state (only touched by its own CPU, IRQs off) */
+typedef struct tick_sched {
+    hrtimer_t sched_timer;      /* Periodic scheduler tick */
+    uint64_t last_tick;         /* Time of the last tick accounted (ns) */
+    bool tick_stopped;
+    tick_stats_t stats;
+} tick_sched_t;
+
+static tick_sched_t tick_cpu_sched[MAX_CPUS];
+static volatile bool tick_nohz_enabled = true;
+
+static inline tick_sched_t* this_tick_sched(void) {
+    return &tick_cpu_sched[smp_processor_id()];
+}
+
+/* Tick hrtimer callback */
+static hrtimer_restart_t tick_sched_timer(hrtimer_t* timer) {
+    tick_sched_t* ts = this_tick_sched();
+
+    /* More than one tick if IRQs were held off for a while */
+    uint64_t ticks = hrtimer_forward(timer, timer_get_ns(), SCHED_TICK_NS);
+    ts->last_tick = timer->expires - SCHED_TICK_NS;
+
+    if (smp_processor_id() == 0) {
+        timer_account_ticks(ticks);
+    }
+    scheduler_tick();
+
+    return HRTIMER_RESTART;
+}
+
+/**
+ * Start this CPU's periodic tick
+ */
+void tick_init_cpu(void) {
+    tick_sched_t* ts = this_tick_sched();
+
+    hrtimer_init_cpu();
+
+    ts->last_tick = timer_get_ns();
+    ts->tick_stopped = false;
+    hrtimer_init(&ts->sched_timer, tick_sched_timer, NULL);
+    hrtimer_start(&ts->sched_timer, ts->last_tick + SCHED_TICK_NS, HRTIMER_MODE_ABS);
+}
+
+/* Time until the next event only the tick can deliver (ns) */
+static uint64_t tick_nohz_next_event(uint64_t now) {
+    uint64_t jiffy = timer_wheel_next_expiry();
+    if (jiffy == HRTIMER_NO_EXPIRY) {
+        return NOHZ_MAX_IDLE_NS;
+    }
+
+    uint64_t expires = jiffy * SCHED_TICK_NS;
+    if (expires <= now) {
+        return 0;
+    }
+    return (expires - now < NOHZ_MAX_IDLE_NS) ? expires - now : NOHZ_MAX_IDLE_NS;
+}
+
+/**
+ * Stop the tick before the idle loop sleeps
+ */
+void tick_nohz_idle_enter(void) {
+    tick_sched_t* ts = this_tick_sched();
+
+    ts->stats.idle_entries++;
+    if (!tick_nohz_enabled || ts->tick_stopped || !sched_can_stop_tick()) {
+        return;
+    }
+
+    uint64_t now = timer_get_ns();
+    uint64_t tick_event = now + tick_nohz_next_event(now);
+
+    /* Not worth it if something needs the CPU soon anyway */
+    uint64_t next = hrtimer_get_next_event(&ts->sched_timer);
+    if (next > tick_event) {
+        next = tick_event;
+    }
+    if (next < now + NOHZ_MIN_IDLE_NS) {
+        return;
+    }
+
+    sched_nohz_enter();
+    hrtimer_start(&ts->sched_timer, tick_event, HRTIMER_MODE_ABS);
+    ts->tick_stopped = true;
+    ts->stats.tick_stops++;
+}
+
+/**
+ * Restart the tick after the idle loop woke up
+ */
+void tick_nohz_idle_exit(void) {
+    tick_sched_t* ts = this_tick_sched();
+
+    if (!ts->tick_stopped) {
+        return;
+    }
+    ts->tick_stopped = false;
+
+    /* Back in phase with the ticks that would have fired */
+    uint64_t ticks = (timer_get_ns() - ts->last_tick) / SCHED_TICK_NS;
+    ts->last_tick += ticks * SCHED_TICK_NS;
+    hrtimer_start(&ts->sched_timer, ts->last_tick + SCHED_TICK_NS, HRTIMER_MODE_ABS);
+
+    if (smp_processor_id() == 0 && ticks > 0) {
+        timer_account_ticks(ticks);
+    }
+    ts->stats.ticks_skipped += ticks;
+    sched_nohz_exit(ticks);
+}
+
+/**
+ * Interrupt taken while tickless: the CPU is busy again
+ * (x86_64 handles IRQs inside HLT, before the idle loop gets to run)
+ */
+void tick_nohz_irq_enter(void) {
+    if (this_tick_sched()->tick_stopped) {
+        tick_nohz_idle_exit();
+    }
+}
+
+/**
+ * Check whether this CPU's tick is stopped
+ */
+bool tick_nohz_tick_stopped(void) {
+    uint64_t flags = interrupts_save();
+    bool stopped = this_tick_sched()->tick_stopped;
+    interrupts_restore(flags);
+    return stopped;
+}
+
+/**
+ * Enable or disable the dynamic tick (takes effect at the next idle entry)
+ */
+void tick_nohz_set_enabled(bool enabled) {
+    tick_nohz_enabled = enabled;
+}
+
+/**
+ * Copy one CPU's dynamic tick counters
+ */
+void tick_get_stats(uint32_t cpu, tick_stats_t* stats) {
+    if (cpu >= MAX_CPUS) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = tick_cpu_sched[cpu].stats;
+}
+
+/**
+ * Print dynamic tick counters of all online CPUs
+ */
+void tick_print_stats(void) {
+    console_printf("Dynamic tick statistics:\n");
+    for (uint32_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!smp_cpu_online(cpu)) {
+            continue;
+        }
+
+        tick_stats_t st;
+        tick_get_stats(cpu, &st);
+        console_printf("  CPU%u: idle=%llu tick_stops=%llu ticks_skipped=%llu\n",
+                       cpu, st.idle_entries, st.tick_stops, st.ticks_skipped);
+    }
+}
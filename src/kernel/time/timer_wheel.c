@@ -0,0 +1,315 @@
+/**
+ * Timer Wheel
+ *
+ * Each CPU has a hierarchical hashed wheel: level 0 has one slot per tick
+ * for the next 256 ticks, and each of the four levels above has 64 slots
+ * covering 64 times the range of the level below (2^32 ticks in total).
+ * A timer is hashed straight into the slot of its expiry at the coarsest
+ * level that still fits, so arming is a list append and cancelling a list
+ * unlink. Higher levels are cascaded lazily: a slot is only redistributed
+ * to the levels below when the wheel reaches it, which happens once every
+ * 256 ticks for level 1 and much more rarely above. Most timeouts are
+ * cancelled before that and never get touched again.
+ */
+
+#include <kernel/timer_wheel.h>
+#include <kernel/hrtimer.h>
+#include <kernel/smp.h>
+#include <kernel/spinlock.h>
+#include <arch/interrupts.h>
+
+#define TVR_BITS        8
+#define TVN_BITS        6
+#define TVR_SIZE        (1 << TVR_BITS)
+#define TVN_SIZE        (1 << TVN_BITS)
+#define TVR_MASK        (TVR_SIZE - 1)
+#define TVN_MASK        (TVN_SIZE - 1)
+#define TVN_LEVELS      4
+
+/* Farthest expiry the wheel can hash; later timers wait in the top level */
+#define WHEEL_MAX_TICKS ((1ULL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
+
+/* Shift of a level above level 0 */
+#define TVN_SHIFT(lvl)  (TVR_BITS + (lvl) * TVN_BITS)
+
+/* Per-CPU wheel; lock is always taken with IRQs disabled */
+typedef struct timer_wheel {
+    spinlock_t lock;
+    uint64_t clk;                           /* Next jiffy to process */
+    timer_list_t* running;                  /* Timer whose callback is executing */
+    uint32_t nr_timers;                     /* Armed timers in all slots */
+    bool ready;
+    list_head_t tv1[TVR_SIZE];              /* Level 0: one slot per tick */
+    list_head_t tvn[TVN_LEVELS][TVN_SIZE];  /* Levels 1-4 */
+} timer_wheel_t;
+
+static timer_wheel_t timer_wheels[MAX_CPUS];
+
+static inline timer_wheel_t* this_timer_wheel(void) {
+    return &timer_wheels[smp_processor_id()];
+}
+
+/**
+ * Time in ticks since boot
+ */
+uint64_t jiffies_get(void) {
+    return timer_get_ns() / SCHED_TICK_NS;
+}
+
+/* Set up the calling CPU's wheel on first use (wheel locked) */
+static void timer_wheel_prepare(timer_wheel_t* wheel) {
+    if (wheel->ready) {
+        return;
+    }
+
+    for (int i = 0; i < TVR_SIZE; i++) {
+        list_init(&wheel->tv1[i]);
+    }
+    for (int lvl = 0; lvl < TVN_LEVELS; lvl++) {
+        for (int i = 0; i < TVN_SIZE; i++) {
+            list_init(&wheel->tvn[lvl][i]);
+        }
+    }
+    wheel->clk = jiffies_get();
+    wheel->ready = true;
+}
+
+/* Slot for an expiry, relative to the wheel's clock */
+static list_head_t* timer_wheel_slot(timer_wheel_t* wheel, uint64_t expires) {
+    if ((int64_t)(expires - wheel->clk) < 0) {
+        return &wheel->tv1[wheel->clk & TVR_MASK];     /* Already due */
+    }
+
+    uint64_t delta = expires - wheel->clk;
+    if (delta < TVR_SIZE) {
+        return &wheel->tv1[expires & TVR_MASK];
+    }
+
+    if (delta > WHEEL_MAX_TICKS) {
+        expires = wheel->clk + WHEEL_MAX_TICKS;     /* Re-hashed at every cascade */
+        delta = WHEEL_MAX_TICKS;
+    }
+
+    int lvl = 0;
+    while (lvl < TVN_LEVELS - 1 && delta >= (1ULL << TVN_SHIFT(lvl + 1))) {
+        lvl++;
+    }
+    return &wheel->tvn[lvl][(expires >> TVN_SHIFT(lvl)) & TVN_MASK];
+}
+
+static void enqueue_timer(timer_wheel_t* wheel, timer_list_t* timer) {
+    list_add_tail(&timer->entry, timer_wheel_slot(wheel, timer->expires));
+    wheel->nr_timers++;
+}
+
+static void detach_timer(timer_wheel_t* wheel, timer_list_t* timer) {
+    list_del(&timer->entry);
+    wheel->nr_timers--;
+}
+
+/* Lock the wheel a timer belongs to (it may move while we wait) */
+static timer_wheel_t* lock_timer_wheel(timer_list_t* timer) {
+    for (;;) {
+        timer_wheel_t* wheel = timer->base;
+        if (wheel == NULL) {
+            wheel = this_timer_wheel();
+        }
+
+        spin_lock(&wheel->lock);
+        if (timer->base == wheel || (timer->base == NULL && wheel == this_timer_wheel())) {
+            return wheel;
+        }
+        spin_unlock(&wheel->lock);
+    }
+}
+
+/**
+ * Initialize a timer
+ */
+void timer_setup(timer_list_t* timer, timer_fn_t function, void* data) {
+    list_init(&timer->entry);
+    timer->expires = 0;
+    timer->function = function;
+    timer->data = data;
+    timer->base = NULL;
+}
+
+/**
+ * Arm or re-arm a timer on the calling CPU
+ */
+bool mod_timer(timer_list_t* timer, uint64_t expires) {
+    uint64_t flags = interrupts_save();
+    timer_wheel_t* wheel = lock_timer_wheel(timer);
+    timer_wheel_t* new_wheel = this_timer_wheel();
+
+    bool pending = timer_pending(timer);
+    if (pending) {
+        detach_timer(wheel, timer);
+    }
+
+    /* Move to this CPU, unless the callback is running on the old one */
+    if (wheel != new_wheel && wheel->running != timer) {
+        timer->base = new_wheel;
+        spin_unlock(&wheel->lock);
+        spin_lock(&new_wheel->lock);
+        wheel = new_wheel;
+    }
+    timer->base = wheel;
+
+    timer_wheel_prepare(wheel);
+    timer->expires = expires;
+    enqueue_timer(wheel, timer);
+
+    spin_unlock_irqrestore(&wheel->lock, flags);
+    return pending;
+}
+
+/**
+ * Cancel a timer without waiting for a running callback
+ */
+bool del_timer(timer_list_t* timer) {
+    if (timer->base == NULL) {
+        return false;
+    }
+
+    uint64_t flags = interrupts_save();
+    timer_wheel_t* wheel = lock_timer_wheel(timer);
+
+    bool pending = timer_pending(timer);
+    if (pending) {
+        detach_timer(wheel, timer);
+    }
+
+    spin_unlock_irqrestore(&wheel->lock, flags);
+    return pending;
+}
+
+/**
+ * Cancel a timer, waiting for its callback if it is running right now
+ */
+bool del_timer_sync(timer_list_t* timer) {
+    if (timer->base == NULL) {
+        return false;
+    }
+
+    for (;;) {
+        uint64_t flags = interrupts_save();
+        timer_wheel_t* wheel = lock_timer_wheel(timer);
+
+        if (wheel->running != timer) {
+            bool pending = timer_pending(timer);
+            if (pending) {
+                detach_timer(wheel, timer);
+            }
+            spin_unlock_irqrestore(&wheel->lock, flags);
+            return pending;
+        }
+
+        spin_unlock_irqrestore(&wheel->lock, flags);
+        __asm__ volatile("" ::: "memory");
+    }
+}
+
+/* Redistribute one slot of a higher level to the levels below
+ * @return The slot index (0: the next level is due as well) */
+static uint32_t cascade(timer_wheel_t* wheel, int lvl) {
+    uint32_t index = (wheel->clk >> TVN_SHIFT(lvl)) & TVN_MASK;
+    list_head_t work;
+
+    list_move_all(&wheel->tvn[lvl][index], &work);
+    while (!list_empty(&work)) {
+        timer_list_t* timer = list_first_entry(&work, timer_list_t, entry);
+        list_del(&timer->entry);
+        list_add_tail(&timer->entry, timer_wheel_slot(wheel, timer->expires));
+    }
+    return index;
+}
+
+/**
+ * Advance the wheel to now and run expired timers
+ */
+void timer_wheel_run(void) {
+    timer_wheel_t* wheel = this_timer_wheel();
+    uint64_t now = jiffies_get();
+
+    spin_lock(&wheel->lock);
+    timer_wheel_prepare(wheel);
+
+    while ((int64_t)(now - wheel->clk) >= 0) {
+        /* Nothing armed: skip the ticks missed while tickless at once */
+        if (wheel->nr_timers == 0) {
+            wheel->clk = now + 1;
+            break;
+        }
+
+        uint32_t index = wheel->clk & TVR_MASK;
+        if (index == 0) {
+            for (int lvl = 0; lvl < TVN_LEVELS && cascade(wheel, lvl) == 0; lvl++) {
+            }
+        }
+
+        list_head_t work;
+        list_move_all(&wheel->tv1[index], &work);
+        wheel->clk++;
+
+        while (!list_empty(&work)) {
+            timer_list_t* timer = list_first_entry(&work, timer_list_t, entry);
+            detach_timer(wheel, timer);
+            wheel->running = timer;
+
+            /* Unlocked: the callback may re-arm timers or wake tasks */
+            spin_unlock(&wheel->lock);
+            timer->function(timer);
+            spin_lock(&wheel->lock);
+
+            wheel->running = NULL;
+        }
+    }
+
+    spin_unlock(&wheel->lock);
+}
+
+/**
+ * Earliest jiffy at which the wheel needs the tick
+ */
+uint64_t timer_wheel_next_expiry(void) {
+    timer_wheel_t* wheel = this_timer_wheel();
+    uint64_t flags = spin_lock_irqsave(&wheel->lock);
+
+    uint64_t next = HRTIMER_NO_EXPIRY;
+    if (!wheel->ready || wheel->nr_timers == 0) {
+        goto out;
+    }
+
+    uint64_t clk = wheel->clk;
+
+    /* Level 0 slots hold exact expiries */
+    for (uint64_t i = 0; i < TVR_SIZE; i++) {
+        if (!list_empty(&wheel->tv1[(clk + i) & TVR_MASK])) {
+            next = clk + i;
+            break;
+        }
+    }
+
+    /* A higher slot needs the tick when it gets cascaded, i.e. on the first
+     * jiffy aligned to its level that maps to it; its timers expire later */
+    for (int lvl = 0; lvl < TVN_LEVELS; lvl++) {
+        uint64_t mask = (1ULL << TVN_SHIFT(lvl)) - 1;
+        uint64_t start = (clk + mask) & ~mask;
+        uint32_t index = (start >> TVN_SHIFT(lvl)) & TVN_MASK;
+
+        for (uint64_t i = 0; i < TVN_SIZE; i++) {
+            if (!list_empty(&wheel->tvn[lvl][(index + i) & TVN_MASK])) {
+                uint64_t when = start + (i << TVN_SHIFT(lvl));
+                if (when < next) {
+                    next = when;
+                }
+                break;
+            }
+        }
+    }
+
+out:
+    spin_unlock_irqrestore(&wheel->lock, flags);
+    return next;
+}